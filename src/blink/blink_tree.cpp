@@ -0,0 +1 @@
+#include "blink_tree.hpp"
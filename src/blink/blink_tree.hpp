@@ -0,0 +1,498 @@
+#ifndef BLINK_TREE_H_
+#define BLINK_TREE_H_
+
+#include<algorithm>
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+#include<memory>
+#include<mutex>
+#include<new>
+#include<type_traits>
+#include<utility>
+#include<vector>
+
+#include "keys/keys.hpp"
+#include "keys/path.hpp"
+#include "olc/latch.hpp"
+#include "pool/pool.hpp"
+
+
+namespace btree
+{
+    // Concurrent B+tree after Lehman and Yao (B-link tree). Every node has a link to its right sibling and
+    // a high key, the keys not less than the high key are right of the node. A split moves the upper half
+    // of a node to a new right sibling and only then adds the separator to the parent, so a reader which
+    // arrives in between finds its key by following the right link instead of starting again.
+    // Readers take no latch, they check the version latch of each node they read (see OlcBtree), without
+    // coupling to the parent. A writer locks the leaf, and to split it the leaf and its parent, never more
+    // than two nodes at a time; it does not have to start from the root again when it meets a split.
+    // As in OlcBtree the keys and the values have to be trivially copyable and the nodes live until
+    // the tree is destroyed.
+    template <typename KEY, typename VALUE, size_t DEGREE,
+              typename SEARCH = default_search, typename ALLOCATOR = std::allocator<char>>
+    class BlinkTree
+    {
+        static_assert(std::is_trivially_copyable<KEY>::value && std::is_trivially_copyable<VALUE>::value,
+            "nodes are read while they are written, keys and values have to be trivially copyable");
+        // a node splits when it holds DEGREE + 1 entries, an inner split gives the middle separator to the
+        // parent and keeps one on each side
+        static_assert(DEGREE >= 2, "an inner split has to leave a separator on both sides");
+
+    public:
+        static const size_t degree = DEGREE;
+
+        using key_t = KEY;
+        using value_t = VALUE;
+        using search_t = SEARCH;
+        using allocator_t = ALLOCATOR;
+        // a scan visits copies of a leaf, re-read if its version changed, then follows the right link
+        using const_reference = KeyValueRef<KEY, const VALUE>;
+
+    private:
+        using KV = KeyValue<key_t, value_t>;
+        using KV_pair = std::pair<key_t, value_t>;
+        using pool_t = NodePool<ALLOCATOR>;
+
+        // The leaves are on level 0. The rightmost node of a level has no high key.
+        // The size and the links are read without the latch too, so they are relaxed atomics written under
+        // the latch, which orders them with the entries. A reader never trusts size beyond the capacity.
+        // The high key is written under the latch and read like the entries: only a reader which validates
+        // the version afterwards acts on it, so it needs no atomic of the key type.
+        struct Node
+        {
+            OptimisticLatch latch;
+            const size_t level;
+            std::atomic<size_t> size{0};
+            std::atomic<Node*> right{nullptr};
+            KEY high_key = KEY();
+            std::atomic<bool> has_high_key{false};
+
+            Node(const size_t level): level(level) {}
+
+            bool is_leaf() const noexcept
+            {
+                return level == 0;
+            }
+
+            // true if k is in the key range of a node right of this one
+            bool is_right_of(const KEY & k) const
+            {
+                return has_high_key.load(std::memory_order_relaxed) && !(k < high_key);
+            }
+
+            Node* right_link() const noexcept
+            {
+                return right.load(std::memory_order_relaxed);
+            }
+
+            size_t size_to_read() const noexcept
+            {
+                return std::min(size.load(std::memory_order_relaxed), DEGREE + 1);
+            }
+
+            void set_size(const size_t new_size) noexcept
+            {
+                size.store(new_size, std::memory_order_relaxed);
+            }
+        };
+
+        // room for one entry more than the degree, a full node takes the new entry and then splits
+        struct Leaf: Node
+        {
+            NodeStorage<KEY, VALUE, DEGREE + 1, split_layout> entries;
+
+            Leaf(): Node(0) {}
+        };
+
+        // child i + 1 is stored with separator i, as in BplusTree
+        struct Inner: Node
+        {
+            Node* first_child = nullptr;
+            NodeStorage<KEY, Node*, DEGREE + 1, split_layout> separators;
+
+            Inner(const size_t level): Node(level) {}
+
+            Node* child(const size_t i) noexcept
+            {
+                return i == 0 ? first_child : separators.value(i - 1);
+            }
+
+            size_t child_for_key(const KEY & k) const
+            {
+                return search_t::upper_bound(separators, this->size_to_read(), k);
+            }
+        };
+
+        // writers lock the pools when they split, the only time a node is taken from them
+        std::mutex pool_mutex;
+        pool_t* leaf_pool;
+        pool_t* inner_pool;
+        std::atomic<Node*> root;
+        // splits move entries to the right, the first leaf stays the first one
+        Leaf* first_leaf;
+
+    public:
+        explicit BlinkTree(const ALLOCATOR & allocator = ALLOCATOR())
+            : leaf_pool(create_pool(allocator)), inner_pool(create_pool(allocator))
+        {
+            first_leaf = new_leaf();
+            root.store(first_leaf, std::memory_order_release);
+        }
+
+        BlinkTree(const BlinkTree &) = delete;
+        BlinkTree & operator=(const BlinkTree &) = delete;
+
+        ALLOCATOR get_allocator() const
+        {
+            return leaf_pool->get_allocator();
+        }
+
+        // Throws duplicated_key_exception if k is present.
+        void add(const key_t & k, const value_t & v)
+        {
+            if (!insert(k, v, false))
+            {
+                BTREE_THROW(duplicated_key_exception());
+            }
+        }
+
+        // Assigns v to k if k is present, adds them otherwise. Returns true if k was added.
+        bool insert_or_assign(const key_t & k, const value_t & v)
+        {
+            return insert(k, v, true);
+        }
+
+        // Copies the value of k to value. Returns false if k is not present.
+        bool find(const key_t & k, value_t & value) const
+        {
+            Leaf* leaf = static_cast<Leaf*>(descend(k, 0, nullptr));
+            uint64_t version = leaf->latch.read_begin();
+            while (true)
+            {
+                size_t size = leaf->size_to_read();
+                size_t pos = search_t::lower_bound(leaf->entries, size, k);
+                bool found = pos < size && !(k < leaf->entries.key(pos));
+                value_t result = found ? leaf->entries.value(pos) : value_t();
+                bool go_right = leaf->is_right_of(k);
+                Node* right = leaf->right_link();
+                if (!leaf->latch.validate(version))
+                {
+                    version = leaf->latch.read_begin();
+                    continue;
+                }
+
+                if (go_right)
+                {
+                    leaf = static_cast<Leaf*>(right);
+                    version = leaf->latch.read_begin();
+                    continue;
+                }
+
+                if (found)
+                {
+                    value = result;
+                }
+
+                return found;
+            }
+        }
+
+        bool contains(const key_t & k) const
+        {
+            value_t value;
+
+            return find(k, value);
+        }
+
+        value_t get(const key_t & k) const
+        {
+            value_t value;
+            if (!find(k, value))
+            {
+                BTREE_THROW(key_does_not_exist_exception());
+            }
+
+            return value;
+        }
+
+        // Calls visit with the entries whose key is in [lo, hi) in key order. Every leaf is copied and
+        // checked before its entries are visited, so a scan along writers sees each key once and in order,
+        // but not a snapshot of the whole range.
+        template<typename VISITOR>
+        void scan(const key_t & lo, const key_t & hi, VISITOR visit) const
+        {
+            scan_leaves(static_cast<Leaf*>(descend(lo, 0, nullptr)), &lo, &hi, visit);
+        }
+
+        std::vector<KV_pair> dump() const
+        {
+            std::vector<KV_pair> entries;
+            scan_leaves(first_leaf, nullptr, nullptr, [&entries] (const_reference entry) {
+                entries.push_back(entry);
+            });
+
+            return entries;
+        }
+
+        // number of levels, a tree with only a root leaf has height 1
+        size_t height() const noexcept
+        {
+            return root.load(std::memory_order_acquire)->level + 1;
+        }
+
+        // the keys and the values are trivially destructible, the nodes go away with the pools
+        ~BlinkTree()
+        {
+            destroy_pool(leaf_pool);
+            destroy_pool(inner_pool);
+        }
+
+    private:
+        // Goes down from the root to the node of level whose key range holds k, following the right links
+        // where a split got in between. A node read while a writer changed it is read again, not the whole
+        // path. path, if given, gets the node each level was left from, the parents of the nodes below.
+        Node* descend(const key_t & k, const size_t level, Node** path) const
+        {
+            Node* node = root.load(std::memory_order_acquire);
+            uint64_t version = node->latch.read_begin();
+            while (true)
+            {
+                bool go_right = node->is_right_of(k);
+                bool arrived = !go_right && node->level == level;
+                Node* next = go_right ? node->right_link()
+                    : (arrived ? nullptr : static_cast<Inner*>(node)->child(static_cast<Inner*>(node)->child_for_key(k)));
+                if (!node->latch.validate(version))
+                {
+                    version = node->latch.read_begin();
+                    continue;
+                }
+
+                if (arrived)
+                {
+                    return node;
+                }
+
+                if (!go_right && path != nullptr)
+                {
+                    path[node->level] = node;
+                }
+
+                node = next;
+                version = node->latch.read_begin();
+            }
+        }
+
+        // node is write locked: goes right until the node whose key range holds k, locking
+        // the right sibling before unlocking the left one
+        static Node* lock_right(Node* node, const key_t & k)
+        {
+            while (node->is_right_of(k))
+            {
+                Node* right = node->right_link();
+                right->latch.lock();
+                node->latch.unlock();
+                node = right;
+            }
+
+            return node;
+        }
+
+        bool insert(const key_t & k, const value_t & v, const bool assign)
+        {
+            Node* path[max_height] = {};
+            Node* node = descend(k, 0, path);
+            node->latch.lock();
+            Leaf* leaf = static_cast<Leaf*>(lock_right(node, k));
+
+            size_t size = leaf->size_to_read();
+            size_t pos = search_t::lower_bound(leaf->entries, size, k);
+            if (pos < size && !(k < leaf->entries.key(pos)))
+            {
+                if (assign)
+                {
+                    leaf->entries.value(pos) = v;
+                }
+                leaf->latch.unlock();
+
+                return false;
+            }
+
+            leaf->entries.insert(pos, size, KV(k, v));
+            leaf->set_size(size + 1);
+            if (size + 1 <= DEGREE)
+            {
+                leaf->latch.unlock();
+
+                return true;
+            }
+
+            add_to_parent(path, leaf, split(leaf));
+
+            return true;
+        }
+
+        // Adds the separator of the split node to the parent, which may split in turn. The node is locked,
+        // it is unlocked once its parent is locked. The parent on the path may have split since it was
+        // read, then the separator goes right; if the tree grew above the path, the parent is looked up.
+        void add_to_parent(Node** path, Node* node, KeyValue<KEY, Node*> && separator)
+        {
+            while (true)
+            {
+                if (node == root.load(std::memory_order_acquire))
+                {
+                    grow(node, std::move(separator));
+                    node->latch.unlock();
+
+                    return;
+                }
+
+                Node* parent = path[node->level + 1];
+                if (parent == nullptr)
+                {
+                    parent = descend(separator.key, node->level + 1, nullptr);
+                }
+
+                parent->latch.lock();
+                Inner* inner = static_cast<Inner*>(lock_right(parent, separator.key));
+                node->latch.unlock();
+
+                size_t size = inner->size_to_read();
+                size_t pos = inner->child_for_key(separator.key);
+                inner->separators.insert(pos, size, std::move(separator));
+                inner->set_size(size + 1);
+                if (size + 1 <= DEGREE)
+                {
+                    inner->latch.unlock();
+
+                    return;
+                }
+
+                separator = split(inner);
+                node = inner;
+            }
+        }
+
+        // the new right sibling takes over the high key and the right link of the node
+        void link_right(Node* node, Node* right, const KEY & separator)
+        {
+            right->right.store(node->right_link(), std::memory_order_relaxed);
+            right->high_key = node->high_key;
+            right->has_high_key.store(node->has_high_key.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+            node->high_key = separator;
+            node->has_high_key.store(true, std::memory_order_relaxed);
+            node->right.store(right, std::memory_order_relaxed);
+        }
+
+        KeyValue<KEY, Node*> split(Leaf* leaf)
+        {
+            Leaf* right = new_leaf();
+            size_t size = leaf->size_to_read();
+            size_t half = size / 2;
+            right->entries.move(leaf->entries, half, size, 0);
+            right->set_size(size - half);
+            leaf->set_size(half);
+            link_right(leaf, right, right->entries.key(0));
+
+            return KeyValue<KEY, Node*>(right->entries.key(0), right);
+        }
+
+        // the middle separator is returned with the new right node, its child becomes the first child there
+        KeyValue<KEY, Node*> split(Inner* inner)
+        {
+            Inner* right = new_inner(inner->level);
+            size_t size = inner->size_to_read();
+            size_t middle = size / 2;
+            right->separators.move(inner->separators, middle + 1, size, 0);
+            right->set_size(size - middle - 1);
+
+            KeyValue<KEY, Node*> separator = inner->separators.take(middle);
+            inner->set_size(middle);
+            right->first_child = separator.value;
+            separator.value = right;
+            link_right(inner, right, separator.key);
+
+            return separator;
+        }
+
+        // the old root is write locked, so nobody else grows the tree
+        void grow(Node* old_root, KeyValue<KEY, Node*> && separator)
+        {
+            Inner* new_root = new_inner(old_root->level + 1);
+            new_root->first_child = old_root;
+            new_root->separators.insert(0, 0, std::move(separator));
+            new_root->set_size(1);
+            root.store(new_root, std::memory_order_release);
+        }
+
+        // Visits the entries in [lo, hi) from leaf on, a null bound is open. A leaf which changed while it
+        // was copied is copied again, keys which a split moved right are found along the right link.
+        template<typename VISITOR>
+        void scan_leaves(Leaf* leaf, const key_t * lo, const key_t * hi, VISITOR visit) const
+        {
+            KV entries[DEGREE + 1];
+            key_t last = key_t();
+            bool visited_any = false;
+
+            uint64_t version = leaf->latch.read_begin();
+            while (true)
+            {
+                size_t size = leaf->size_to_read();
+                size_t count = 0;
+                bool reached_hi = false;
+                for (size_t i = 0; i < size && !reached_hi; i++)
+                {
+                    const key_t & k = leaf->entries.key(i);
+                    reached_hi = hi != nullptr && !(k < *hi);
+                    if (!reached_hi && (visited_any ? last < k : lo == nullptr || !(k < *lo)))
+                    {
+                        entries[count++] = KV(k, leaf->entries.value(i));
+                    }
+                }
+
+                Leaf* right = static_cast<Leaf*>(leaf->right_link());
+                if (!leaf->latch.validate(version))
+                {
+                    version = leaf->latch.read_begin();
+                    continue;
+                }
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    visit(const_reference(entries[i].key, entries[i].value));
+                }
+
+                if (count > 0)
+                {
+                    last = entries[count - 1].key;
+                    visited_any = true;
+                }
+
+                if (reached_hi || right == nullptr)
+                {
+                    return;
+                }
+
+                leaf = right;
+                version = leaf->latch.read_begin();
+            }
+        }
+
+        Leaf* new_leaf()
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+
+            return new (leaf_pool->allocate(sizeof(Leaf))) Leaf();
+        }
+
+        Inner* new_inner(const size_t level)
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+
+            return new (inner_pool->allocate(sizeof(Inner))) Inner(level);
+        }
+    };
+}
+
+#endif
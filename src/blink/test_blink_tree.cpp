@@ -0,0 +1 @@
+#include "test_blink_tree.hpp"
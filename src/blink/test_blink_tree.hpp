@@ -0,0 +1,182 @@
+#ifndef TEST_BLINK_TREE_H_
+#define TEST_BLINK_TREE_H_
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "blink/blink_tree.hpp"
+
+
+using namespace btree;
+
+// dump goes from the first leaf along the right links only, so the keys a split moved to a new
+// leaf have to be reachable through the right link of the split one
+TEST(BlinkTree, splitLeavesAreReachedThroughTheirRightLinks) {
+    BlinkTree<int, int, 2> t;
+    std::map<int, int> expected;
+    std::mt19937 random(7);
+    while (expected.size() < 300)
+    {
+        int k = random() % 1000;
+        if (!expected.insert(std::make_pair(k, -k)).second)
+        {
+            continue;
+        }
+        t.add(k, -k);
+
+        std::vector<std::pair<int, int>> entries(expected.begin(), expected.end());
+        ASSERT_EQ(entries, t.dump());
+    }
+
+    ASSERT_GT(t.height(), 4);
+    int value = 0;
+    ASSERT_TRUE(t.find(expected.rbegin()->first, value));
+    ASSERT_EQ(-expected.rbegin()->first, value);
+}
+
+namespace {
+
+// wider than any atomic instruction, so the tree must not hold it in a std::atomic
+struct WideKey
+{
+    uint64_t high;
+    uint64_t middle;
+    uint64_t low;
+};
+
+bool operator<(const WideKey & a, const WideKey & b)
+{
+    if (a.high != b.high)
+    {
+        return a.high < b.high;
+    }
+    if (a.middle != b.middle)
+    {
+        return a.middle < b.middle;
+    }
+    return a.low < b.low;
+}
+
+}
+
+TEST(BlinkTree, wideKeysAreSplitAndFound) {
+    static_assert(sizeof(WideKey) == 24, "the key is wider than the atomic instructions");
+    BlinkTree<WideKey, int, 3> t;
+    for (int i = 0; i < 500; ++i)
+    {
+        WideKey k = {uint64_t(i % 7), uint64_t(i), uint64_t(-i)};
+        t.add(k, i);
+    }
+
+    ASSERT_GT(t.height(), 2);
+    for (int i = 0; i < 500; ++i)
+    {
+        WideKey k = {uint64_t(i % 7), uint64_t(i), uint64_t(-i)};
+        int value = -1;
+        ASSERT_TRUE(t.find(k, value));
+        ASSERT_EQ(i, value);
+    }
+    WideKey missing = {3, 1, 0};
+    int value = 0;
+    ASSERT_FALSE(t.find(missing, value));
+}
+
+// The writers append: each of them takes the next key of a shared counter, so all of them
+// keep splitting the rightmost nodes. A reader which finds a key finds the keys before it
+// which were added before it.
+TEST(BlinkTree, concurrentAppends) {
+    const int writers = 4;
+    const int keys = 20000;
+    BlinkTree<int, int, 8> t;
+    std::atomic<int> next_key{0};
+    std::atomic<int> added{0};
+    std::atomic<bool> writing{true};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; w++)
+    {
+        threads.emplace_back([&t, &next_key, &added] {
+            for (int k = next_key++; k < keys; k = next_key++)
+            {
+                t.add(k, -k);
+                added++;
+            }
+        });
+    }
+    for (int r = 0; r < 4; r++)
+    {
+        threads.emplace_back([&t, &writing, &added, &errors, r] {
+            std::mt19937 random(r);
+            while (writing.load())
+            {
+                int k = random() % keys;
+                int value = 0;
+                if (t.find(k, value) && value != -k)
+                {
+                    errors++;
+                }
+                if (added.load() == keys && !t.contains(k))
+                {
+                    errors++;
+                }
+            }
+        });
+    }
+
+    for (int w = 0; w < writers; w++)
+    {
+        threads[w].join();
+    }
+    writing.store(false);
+    for (size_t i = writers; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    ASSERT_EQ(0, errors.load());
+    std::vector<std::pair<int, int>> entries = t.dump();
+    ASSERT_EQ(keys, entries.size());
+    for (int k = 0; k < keys; k++)
+    {
+        ASSERT_EQ(std::make_pair(k, -k), entries[k]);
+    }
+}
+
+TEST(BlinkTree, scansAlongWritersSeeOrderedKeys) {
+    using tree_t = BlinkTree<int, int, 3>;
+    tree_t t;
+    std::atomic<bool> writing{true};
+    std::atomic<int> errors{0};
+
+    std::thread writer([&t, &writing] {
+        std::mt19937 random(1);
+        for (int i = 0; i < 20000; i++)
+        {
+            t.insert_or_assign(random() % 100000, i);
+        }
+        writing.store(false);
+    });
+
+    while (writing.load())
+    {
+        int previous = -1;
+        t.scan(1000, 90000, [&previous, &errors] (tree_t::const_reference entry) {
+            if (entry.key <= previous || entry.key < 1000 || entry.key >= 90000)
+            {
+                errors++;
+            }
+            previous = entry.key;
+        });
+    }
+    writer.join();
+
+    ASSERT_EQ(0, errors.load());
+}
+
+#endif
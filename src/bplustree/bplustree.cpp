@@ -0,0 +1 @@
+#include "bplustree.hpp"
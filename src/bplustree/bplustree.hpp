@@ -0,0 +1,693 @@
+#ifndef BPLUSTREE_H_
+#define BPLUSTREE_H_
+
+#include<cstddef>
+#include<iterator>
+#include<memory>
+#include<new>
+#include<string>
+#include<type_traits>
+#include<utility>
+#include<vector>
+
+#include "keys/keys.hpp"
+#include "keys/path.hpp"
+#include "pool/pool.hpp"
+
+
+namespace btree
+{
+    // The separator between two neighbour leaves, any key in (left, right] would do.
+    // Key types which can be shortened overload it, the inner nodes hold the short separators.
+    template<typename KEY>
+    KEY shortest_separator(const KEY &, const KEY & right)
+    {
+        return right;
+    }
+
+    // the shortest prefix of right which is greater than left
+    template<typename CHAR, typename TRAITS, typename ALLOCATOR>
+    std::basic_string<CHAR, TRAITS, ALLOCATOR> shortest_separator(
+        const std::basic_string<CHAR, TRAITS, ALLOCATOR> & left, const std::basic_string<CHAR, TRAITS, ALLOCATOR> & right)
+    {
+        size_t common = 0;
+        while (common < left.size() && common < right.size() && TRAITS::eq(left[common], right[common]))
+        {
+            common++;
+        }
+
+        return right.substr(0, common + 1);
+    }
+
+
+    // B+tree variant of Btree: the values are only in the leaves, the inner nodes hold separator keys and
+    // child pointers. The leaves are linked to their neighbours, iterators and scans follow the links.
+    // The keys less than a separator are left of it, the others are right of it.
+    template <typename KEY, typename VALUE, size_t DEGREE,
+              typename LAYOUT = interleaved_layout, typename SEARCH = default_search,
+              typename ALLOCATOR = std::allocator<char>>
+    class BplusTree
+    {
+    public:
+        static const size_t degree = DEGREE;
+        // an inner node takes about as much memory as a leaf, without values it has room for more keys
+        static const size_t inner_degree =
+            DEGREE * sizeof(KeyValue<KEY, VALUE>) / (sizeof(KEY) + sizeof(void*)) > DEGREE
+                ? DEGREE * sizeof(KeyValue<KEY, VALUE>) / (sizeof(KEY) + sizeof(void*))
+                : DEGREE;
+
+        using key_t = KEY;
+        using value_t = VALUE;
+        using layout_t = LAYOUT;
+        using search_t = SEARCH;
+        using allocator_t = ALLOCATOR;
+    private:
+        using leaf_storage_t = NodeStorage<KEY, VALUE, DEGREE + 1, LAYOUT>;
+        // const KEY &, or KEY when the leaves build the keys they are asked for (prefix_compressed_layout)
+        using key_holder_t = decltype(std::declval<const leaf_storage_t &>().key(0));
+
+    public:
+        using reference = KeyValueRef<KEY, VALUE, key_holder_t>;
+        using const_reference = KeyValueRef<KEY, const VALUE, key_holder_t>;
+
+    private:
+        using KV = KeyValue<key_t, value_t>;
+        using KV_pair = std::pair<key_t, value_t>;
+        using pool_t = NodePool<ALLOCATOR>;
+        using allocator_traits = std::allocator_traits<ALLOCATOR>;
+        // entries buffered outside of the nodes come from the allocator of the tree too
+        using entries_t = std::vector<KV, typename allocator_traits::template rebind_alloc<KV>>;
+
+        static const bool nodes_are_trivially_destructible =
+            std::is_trivially_destructible<KEY>::value && std::is_trivially_destructible<VALUE>::value;
+
+        struct Node
+        {
+            const bool is_leaf;
+            size_t size = 0;
+
+            Node(const bool is_leaf): is_leaf(is_leaf) {}
+        };
+
+        struct Leaf: Node
+        {
+            // room for one entry more than the degree, a full leaf takes the new entry and then splits
+            leaf_storage_t entries;
+            Leaf* prev = nullptr;
+            Leaf* next = nullptr;
+
+            Leaf(): Node(true) {}
+        };
+
+        // child i + 1 is stored with separator i, the keys are in one array for the search
+        struct Inner: Node
+        {
+            Node* first_child = nullptr;
+            NodeStorage<KEY, Node*, inner_degree + 1, split_layout> separators;
+
+            Inner(): Node(false) {}
+
+            Node* child(const size_t i) noexcept
+            {
+                return i == 0 ? first_child : separators.value(i - 1);
+            }
+
+            size_t child_for_key(const KEY & k) const
+            {
+                return search_t::upper_bound(separators, this->size, k);
+            }
+        };
+
+        // the inner nodes visited from the root to a leaf and the child taken in each of them
+        using Path = NodePath<Inner>;
+
+        pool_t* leaf_pool;
+        pool_t* inner_pool;
+        Node* root;
+        Leaf* first_leaf;
+        Leaf* last_leaf;
+
+    public:
+        // Bidirectional iterator over the entries in key order, it follows the links between the leaves.
+        // It stays valid until the tree is modified.
+        template<bool IS_CONST>
+        class Iterator
+        {
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = std::pair<KEY, VALUE>;
+            using difference_type = std::ptrdiff_t;
+            using reference = typename std::conditional<IS_CONST, const_reference, BplusTree::reference>::type;
+
+            // the entry is a proxy, operator-> has to return something which holds it
+            struct pointer
+            {
+                reference entry;
+
+                const reference* operator->() const noexcept
+                {
+                    return &entry;
+                }
+            };
+
+            Iterator() = default;
+
+            template<bool OTHER_IS_CONST, typename = typename std::enable_if<IS_CONST || !OTHER_IS_CONST>::type>
+            Iterator(const Iterator<OTHER_IS_CONST> & other) noexcept
+                : tree(other.tree), leaf(other.leaf), pos(other.pos) {}
+
+            reference operator*() const noexcept(std::is_reference<key_holder_t>::value)
+            {
+                return reference(leaf->entries.key(pos), leaf->entries.value(pos));
+            }
+
+            pointer operator->() const noexcept(std::is_reference<key_holder_t>::value)
+            {
+                return pointer{**this};
+            }
+
+            Iterator & operator++() noexcept
+            {
+                if (++pos == leaf->size)
+                {
+                    leaf = leaf->next;
+                    pos = 0;
+                }
+
+                return *this;
+            }
+
+            Iterator & operator--() noexcept
+            {
+                if (leaf == nullptr)
+                {
+                    leaf = tree->last_leaf;
+                    pos = leaf->size;
+                }
+                else if (pos == 0)
+                {
+                    leaf = leaf->prev;
+                    pos = leaf->size;
+                }
+                pos--;
+
+                return *this;
+            }
+
+            Iterator operator++(int) noexcept
+            {
+                Iterator old = *this;
+                ++(*this);
+
+                return old;
+            }
+
+            Iterator operator--(int) noexcept
+            {
+                Iterator old = *this;
+                --(*this);
+
+                return old;
+            }
+
+            friend bool operator==(const Iterator & a, const Iterator & b) noexcept
+            {
+                return a.leaf == b.leaf && a.pos == b.pos;
+            }
+
+            friend bool operator!=(const Iterator & a, const Iterator & b) noexcept
+            {
+                return !(a == b);
+            }
+
+        private:
+            friend class BplusTree;
+            template<bool> friend class Iterator;
+
+            const BplusTree* tree = nullptr;
+            // nullptr past the last entry
+            Leaf* leaf = nullptr;
+            size_t pos = 0;
+
+            Iterator(const BplusTree* tree, Leaf* leaf, size_t pos) noexcept: tree(tree), leaf(leaf), pos(pos) {}
+        };
+
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        explicit BplusTree(const ALLOCATOR & allocator = ALLOCATOR())
+            : leaf_pool(create_pool(allocator)), inner_pool(create_pool(allocator))
+        {
+            reset_to_empty_leaf();
+        }
+
+        BplusTree(const BplusTree &) = delete;
+        BplusTree & operator=(const BplusTree &) = delete;
+
+        // the nodes move together with the pools they live in, the moved-from tree gets new ones
+        BplusTree(BplusTree && other)
+            : leaf_pool(other.leaf_pool), inner_pool(other.inner_pool),
+              root(other.root), first_leaf(other.first_leaf), last_leaf(other.last_leaf)
+        {
+            other.leaf_pool = create_pool(leaf_pool->get_allocator());
+            other.inner_pool = create_pool(inner_pool->get_allocator());
+            other.reset_to_empty_leaf();
+        }
+
+        // The pools are taken over only if the allocator propagates on move assignment or both allocators
+        // are equal, otherwise the entries move into the nodes of this tree. other is left empty.
+        BplusTree & operator=(BplusTree && other)
+        {
+            if (this == &other)
+            {
+                return *this;
+            }
+
+            if (allocator_traits::propagate_on_container_move_assignment::value || get_allocator() == other.get_allocator())
+            {
+                swap_nodes(other);
+                other.clear();
+
+                return *this;
+            }
+
+            entries_t entries = other.take_entries();
+            clear();
+            add_entries(entries);
+
+            return *this;
+        }
+
+        // Like operator= the pools are exchanged only if the allocator propagates on swap or both
+        // allocators are equal, otherwise the entries move between the pools.
+        void swap(BplusTree & other)
+        {
+            if (allocator_traits::propagate_on_container_swap::value || get_allocator() == other.get_allocator())
+            {
+                swap_nodes(other);
+
+                return;
+            }
+
+            entries_t mine = take_entries();
+            entries_t theirs = other.take_entries();
+            add_entries(theirs);
+            other.add_entries(mine);
+        }
+
+        ALLOCATOR get_allocator() const
+        {
+            return leaf_pool->get_allocator();
+        }
+
+        // Throws duplicated_key_exception if k is present.
+        template<typename K, typename V>
+        void add(K && k, V && v)
+        {
+            Path path;
+            Leaf* leaf = find_leaf(k, path);
+            size_t pos = search_t::lower_bound(leaf->entries, leaf->size, k);
+            if (is_key_at(leaf, pos, k))
+            {
+                BTREE_THROW(duplicated_key_exception());
+            }
+
+            add_to_leaf(path, leaf, pos, KV(std::forward<K>(k), std::forward<V>(v)));
+        }
+
+        // Assigns v to k if k is present, adds them otherwise. Returns true if k was added.
+        template<typename V>
+        bool insert_or_assign(const key_t & k, V && v)
+        {
+            Path path;
+            Leaf* leaf = find_leaf(k, path);
+            size_t pos = search_t::lower_bound(leaf->entries, leaf->size, k);
+            if (is_key_at(leaf, pos, k))
+            {
+                leaf->entries.value(pos) = std::forward<V>(v);
+
+                return false;
+            }
+
+            add_to_leaf(path, leaf, pos, KV(k, std::forward<V>(v)));
+
+            return true;
+        }
+
+        value_t & get(const key_t & k)
+        {
+            value_t* value = find(k);
+            if (value == nullptr)
+            {
+                BTREE_THROW(key_does_not_exist_exception());
+            }
+
+            return *value;
+        }
+
+        value_t* find(const key_t & k) noexcept
+        {
+            Path path;
+            Leaf* leaf = find_leaf(k, path);
+            size_t pos = search_t::lower_bound(leaf->entries, leaf->size, k);
+
+            return is_key_at(leaf, pos, k) ? &leaf->entries.value(pos) : nullptr;
+        }
+
+        const value_t* find(const key_t & k) const noexcept
+        {
+            return const_cast<BplusTree*>(this)->find(k);
+        }
+
+        bool contains(const key_t & k) const noexcept
+        {
+            return find(k) != nullptr;
+        }
+
+        SearchedValue<value_t> try_get(const key_t & k) noexcept
+        {
+            value_t* value = find(k);
+
+            return SearchedValue<value_t>(value != nullptr, value);
+        }
+
+        iterator begin() noexcept
+        {
+            return iterator(this, first_leaf->size == 0 ? nullptr : first_leaf, 0);
+        }
+
+        iterator end() noexcept
+        {
+            return iterator(this, nullptr, 0);
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return const_cast<BplusTree*>(this)->begin();
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_cast<BplusTree*>(this)->end();
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        const_reverse_iterator crbegin() const noexcept
+        {
+            return rbegin();
+        }
+
+        const_reverse_iterator crend() const noexcept
+        {
+            return rend();
+        }
+
+        // the first entry whose key is not less than k
+        iterator lower_bound(const key_t & k) noexcept
+        {
+            Path path;
+            Leaf* leaf = find_leaf(k, path);
+
+            return iterator_at(leaf, search_t::lower_bound(leaf->entries, leaf->size, k));
+        }
+
+        // the first entry whose key is greater than k
+        iterator upper_bound(const key_t & k) noexcept
+        {
+            Path path;
+            Leaf* leaf = find_leaf(k, path);
+
+            return iterator_at(leaf, search_t::upper_bound(leaf->entries, leaf->size, k));
+        }
+
+        const_iterator lower_bound(const key_t & k) const noexcept
+        {
+            return const_cast<BplusTree*>(this)->lower_bound(k);
+        }
+
+        const_iterator upper_bound(const key_t & k) const noexcept
+        {
+            return const_cast<BplusTree*>(this)->upper_bound(k);
+        }
+
+        // the entries with key k, the keys are unique so it is empty or holds one entry
+        std::pair<iterator, iterator> equal_range(const key_t & k) noexcept
+        {
+            iterator first = lower_bound(k);
+            iterator last = first;
+            if (first != end() && !(k < first->key))
+            {
+                ++last;
+            }
+
+            return std::make_pair(first, last);
+        }
+
+        // Calls visit with the entries whose key is in [lo, hi) in key order. After one descent to lo
+        // the scan goes along the leaves.
+        template<typename VISITOR>
+        void scan(const key_t & lo, const key_t & hi, VISITOR visit)
+        {
+            for (iterator it = lower_bound(lo); it != end() && it->key < hi; ++it)
+            {
+                visit(*it);
+            }
+        }
+
+        std::vector<KV_pair> dump() const
+        {
+            return std::vector<KV_pair>(begin(), end());
+        }
+
+        void clear()
+        {
+            destroy(root);
+            reset_to_empty_leaf();
+        }
+
+        // number of levels, a tree with only a root leaf has height 1
+        size_t height() const noexcept
+        {
+            size_t result = 1;
+            for (const Node* n = root; !n->is_leaf; n = static_cast<const Inner*>(n)->first_child)
+            {
+                result++;
+            }
+
+            return result;
+        }
+
+        ~BplusTree()
+        {
+            if (!nodes_are_trivially_destructible)
+            {
+                destroy(root);
+            }
+
+            destroy_pool(leaf_pool);
+            destroy_pool(inner_pool);
+        }
+
+    private:
+        void swap_nodes(BplusTree & other) noexcept
+        {
+            std::swap(leaf_pool, other.leaf_pool);
+            std::swap(inner_pool, other.inner_pool);
+            std::swap(root, other.root);
+            std::swap(first_leaf, other.first_leaf);
+            std::swap(last_leaf, other.last_leaf);
+        }
+
+        // moves the entries out in order and leaves the tree empty
+        entries_t take_entries()
+        {
+            entries_t entries(get_allocator());
+            for (iterator it = begin(); it != end(); ++it)
+            {
+                entries.push_back(KV(it->key, std::move(it->value)));
+            }
+            clear();
+
+            return entries;
+        }
+
+        void add_entries(entries_t & entries)
+        {
+            for (KV & kv : entries)
+            {
+                add(std::move(kv.key), std::move(kv.value));
+            }
+        }
+
+        Leaf* find_leaf(const key_t & k, Path & path) noexcept
+        {
+            Node* n = root;
+            while (!n->is_leaf)
+            {
+                Inner* inner = static_cast<Inner*>(n);
+                size_t pos = inner->child_for_key(k);
+                path.steps[path.length++] = typename Path::Step{inner, pos};
+                n = inner->child(pos);
+            }
+
+            return static_cast<Leaf*>(n);
+        }
+
+        static bool is_key_at(Leaf* leaf, const size_t pos, const key_t & k)
+        {
+            return pos < leaf->size && leaf->entries.is_key(pos, k);
+        }
+
+        iterator iterator_at(Leaf* leaf, const size_t pos) noexcept
+        {
+            if (pos < leaf->size)
+            {
+                return iterator(this, leaf, pos);
+            }
+
+            return iterator(this, leaf->next, 0);
+        }
+
+        // Adds the entry to the leaf at the end of the path. A leaf which becomes too big moves its upper half
+        // to a new leaf and the shortest separator of the two leaves goes up, an inner node which becomes
+        // too big moves its middle separator up.
+        void add_to_leaf(Path & path, Leaf* leaf, const size_t pos, KV && kv)
+        {
+            leaf->entries.insert(pos, leaf->size, std::move(kv));
+            if (++leaf->size <= DEGREE)
+            {
+                return;
+            }
+
+            Leaf* right = split(leaf);
+            KeyValue<KEY, Node*> separator(
+                shortest_separator(leaf->entries.key(leaf->size - 1), right->entries.key(0)), right);
+
+            for (size_t level = path.length; level-- > 0;)
+            {
+                Inner* n = path.steps[level].node;
+                n->separators.insert(path.steps[level].pos, n->size, std::move(separator));
+                if (++n->size <= inner_degree)
+                {
+                    return;
+                }
+
+                separator = split(n);
+            }
+
+            grow(std::move(separator));
+        }
+
+        Leaf* split(Leaf* leaf)
+        {
+            Leaf* right = new (leaf_pool->allocate(sizeof(Leaf))) Leaf();
+            size_t half = leaf->size / 2;
+            right->entries.move(leaf->entries, half, leaf->size, 0);
+            right->size = leaf->size - half;
+            leaf->size = half;
+
+            right->prev = leaf;
+            right->next = leaf->next;
+            if (leaf->next != nullptr)
+            {
+                leaf->next->prev = right;
+            }
+            else
+            {
+                last_leaf = right;
+            }
+            leaf->next = right;
+
+            return right;
+        }
+
+        // the middle separator is returned with the new right node, its child becomes the first child there
+        KeyValue<KEY, Node*> split(Inner* inner)
+        {
+            Inner* right = new (inner_pool->allocate(sizeof(Inner))) Inner();
+            size_t middle = inner->size / 2;
+            right->separators.move(inner->separators, middle + 1, inner->size, 0);
+            right->size = inner->size - middle - 1;
+
+            KeyValue<KEY, Node*> separator = inner->separators.take(middle);
+            inner->size = middle;
+            right->first_child = separator.value;
+            separator.value = right;
+
+            return separator;
+        }
+
+        void grow(KeyValue<KEY, Node*> && separator)
+        {
+            Inner* new_root = new (inner_pool->allocate(sizeof(Inner))) Inner();
+            new_root->first_child = root;
+            new_root->separators.insert(0, 0, std::move(separator));
+            new_root->size = 1;
+            root = new_root;
+        }
+
+        void reset_to_empty_leaf()
+        {
+            Leaf* leaf = new (leaf_pool->allocate(sizeof(Leaf))) Leaf();
+            root = leaf;
+            first_leaf = leaf;
+            last_leaf = leaf;
+        }
+
+        void destroy(Node* n) noexcept
+        {
+            if (n->is_leaf)
+            {
+                Leaf* leaf = static_cast<Leaf*>(n);
+                leaf->~Leaf();
+                leaf_pool->release(leaf);
+
+                return;
+            }
+
+            Inner* inner = static_cast<Inner*>(n);
+            for (size_t i = 0; i <= inner->size; i++)
+            {
+                destroy(inner->child(i));
+            }
+            inner->~Inner();
+            inner_pool->release(inner);
+        }
+    };
+
+    template <typename KEY, typename VALUE, size_t DEGREE, typename LAYOUT, typename SEARCH, typename ALLOCATOR>
+    const size_t BplusTree<KEY, VALUE, DEGREE, LAYOUT, SEARCH, ALLOCATOR>::inner_degree;
+}
+
+#endif
@@ -0,0 +1 @@
+#include "test_bplustree.hpp"
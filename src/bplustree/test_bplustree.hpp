@@ -0,0 +1,358 @@
+#ifndef TEST_BPLUSTREE_H_
+#define TEST_BPLUSTREE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "bplustree/bplustree.hpp"
+#include "measurable/measurable_test_utils.hpp"
+
+
+using namespace btree;
+
+TEST(BplusTree, empty) {
+    BplusTree<int, int, 4> t;
+
+    ASSERT_TRUE(t.begin() == t.end());
+    ASSERT_EQ(nullptr, t.find(1));
+    ASSERT_FALSE(t.contains(1));
+    ASSERT_THROW(t.get(1), key_does_not_exist_exception);
+    ASSERT_EQ(1, t.height());
+}
+
+TEST(BplusTree, addAndFind) {
+    for (size_t n = 0; n < 200; n += 7)
+    {
+        BplusTree<int, std::string, 2> t;
+        std::map<int, std::string> expected;
+        std::srand(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            int k = std::rand() % 1000;
+            if (expected.insert(std::make_pair(k, std::to_string(k))).second)
+            {
+                t.add(k, std::to_string(k));
+            }
+        }
+
+        std::vector<std::pair<int, std::string>> entries(expected.begin(), expected.end());
+        ASSERT_EQ(entries, t.dump());
+        for (int k = -1; k < 1001; k++)
+        {
+            ASSERT_EQ(expected.count(k) == 1, t.contains(k));
+        }
+    }
+}
+
+TEST(BplusTree, duplicateKey) {
+    BplusTree<int, int, 3> t;
+    for (int i = 0; i < 100; i++)
+    {
+        t.add(i, i);
+    }
+
+    ASSERT_THROW(t.add(50, 0), duplicated_key_exception);
+    ASSERT_EQ(50, t.get(50));
+}
+
+TEST(BplusTree, insertOrAssign) {
+    BplusTree<int, int, 3> t;
+    for (int i = 0; i < 100; i++)
+    {
+        ASSERT_TRUE(t.insert_or_assign(i, i));
+    }
+
+    ASSERT_FALSE(t.insert_or_assign(42, -42));
+    ASSERT_EQ(-42, t.get(42));
+    ASSERT_EQ(-42, *t.try_get(42));
+    ASSERT_FALSE(static_cast<bool>(t.try_get(100)));
+}
+
+TEST(BplusTree, innerNodesHaveHigherFanoutForBigValues) {
+    using tree_t = BplusTree<int, std::array<char, 256>, 4>;
+
+    ASSERT_GT(tree_t::inner_degree, 4 * 10);
+
+    tree_t t;
+    for (int i = 0; i < 10000; i++)
+    {
+        t.add(i, std::array<char, 256>());
+    }
+
+    // the leaves hold at most 4 entries, one or two levels of wide inner nodes are above them
+    ASSERT_LE(t.height(), 4);
+}
+
+TEST(BplusTree, iterators) {
+    BplusTree<int, int, 2, split_layout> t;
+    for (int i = 99; i >= 0; i--)
+    {
+        t.add(i * 2, i);
+    }
+
+    int expected = 0;
+    for (auto it = t.begin(); it != t.end(); it++)
+    {
+        ASSERT_EQ(expected, it->key);
+        it->value = -it->key;
+        expected += 2;
+    }
+    ASSERT_EQ(200, expected);
+
+    for (auto it = t.crbegin(); it != t.crend(); ++it)
+    {
+        expected -= 2;
+        ASSERT_EQ(expected, it->key);
+        ASSERT_EQ(-expected, it->value);
+    }
+    ASSERT_EQ(0, expected);
+}
+
+TEST(BplusTree, bounds) {
+    BplusTree<int, int, 3> t;
+    std::vector<int> keys;
+    for (int i = 0; i < 300; i++)
+    {
+        t.add(i * 3, i);
+        keys.push_back(i * 3);
+    }
+
+    for (int k = -2; k < 905; k++)
+    {
+        auto lower = std::lower_bound(keys.begin(), keys.end(), k);
+        auto upper = std::upper_bound(keys.begin(), keys.end(), k);
+
+        ASSERT_EQ(lower - keys.begin(), std::distance(t.begin(), t.lower_bound(k)));
+        ASSERT_EQ(upper - keys.begin(), std::distance(t.begin(), t.upper_bound(k)));
+        ASSERT_EQ(k % 3 == 0 && k >= 0 && k < 900 ? 1 : 0,
+            std::distance(t.equal_range(k).first, t.equal_range(k).second));
+    }
+}
+
+TEST(BplusTree, leavesAreSearchedWithTheSearchPolicy) {
+    // a single leaf, there are no inner nodes to search
+    BplusTree<int, int, 8, interleaved_layout, CountingSearch> t;
+    for (int i = 0; i < 8; i++)
+    {
+        t.add(i * 2, i);
+    }
+
+    CountingSearch::searches = 0;
+    ASSERT_EQ(3, t.get(6));
+    ASSERT_EQ(nullptr, t.find(7));
+    ASSERT_EQ(8, std::distance(t.begin(), t.lower_bound(15)));
+    ASSERT_EQ(4, std::distance(t.begin(), t.upper_bound(6)));
+    ASSERT_EQ(4, CountingSearch::searches);
+}
+
+TEST(BplusTree, scan) {
+    using tree_t = BplusTree<int, int, 4>;
+    tree_t t;
+    for (int i = 0; i < 1000; i++)
+    {
+        t.add(i, i);
+    }
+
+    std::vector<int> scanned;
+    t.scan(250, 350, [&scanned] (tree_t::reference entry) {
+        scanned.push_back(entry.key);
+    });
+
+    ASSERT_EQ(100, scanned.size());
+    ASSERT_EQ(250, scanned.front());
+    ASSERT_EQ(349, scanned.back());
+}
+
+TEST(BplusTree, stringKeysAndMoveOnlyValues) {
+    BplusTree<std::string, std::unique_ptr<int>, 3> t;
+    for (int i = 0; i < 500; i++)
+    {
+        t.add(std::to_string(i), std::unique_ptr<int>(new int(i)));
+    }
+
+    ASSERT_EQ(123, *t.get("123"));
+    ASSERT_EQ("99", (--t.end())->key);
+}
+
+TEST(BplusTree, shortestSeparator) {
+    ASSERT_EQ(7, shortest_separator(3, 7));
+    ASSERT_EQ("b", shortest_separator(std::string("abc"), std::string("bcd")));
+    ASSERT_EQ("http://example.com/b", shortest_separator(
+        std::string("http://example.com/a/very/long/path"), std::string("http://example.com/b/another/path")));
+    ASSERT_EQ("abcd", shortest_separator(std::string("abc"), std::string("abcde")));
+    ASSERT_EQ("abd", shortest_separator(std::string("abcz"), std::string("abd")));
+}
+
+TEST(BplusTree, truncatedSeparatorsKeepStringKeysFindable) {
+    BplusTree<std::string, int, 3> t;
+    std::vector<std::string> urls;
+    for (int i = 0; i < 2000; i++)
+    {
+        urls.push_back("https://www.example.com/section/" + std::to_string(i % 37) + "/item/" + std::to_string(i));
+    }
+    std::shuffle(urls.begin(), urls.end(), std::mt19937(42));
+
+    for (size_t i = 0; i < urls.size(); i++)
+    {
+        t.add(urls[i], static_cast<int>(i));
+    }
+
+    for (size_t i = 0; i < urls.size(); i++)
+    {
+        ASSERT_EQ(static_cast<int>(i), t.get(urls[i]));
+        ASSERT_FALSE(t.contains(urls[i] + "/"));
+        ASSERT_FALSE(t.contains(urls[i].substr(0, urls[i].size() - 1) + "~"));
+    }
+
+    std::sort(urls.begin(), urls.end());
+    std::vector<std::string> keys;
+    for (auto it = t.begin(); it != t.end(); ++it)
+    {
+        keys.push_back(it->key);
+    }
+    ASSERT_EQ(urls, keys);
+    ASSERT_EQ(urls[1000], t.lower_bound(urls[999] + "!")->key);
+}
+
+TEST(BplusTree, prefixCompressedLeaves) {
+    using tree_t = BplusTree<std::string, int, 8, prefix_compressed_layout>;
+    tree_t t;
+    std::map<std::string, int> expected;
+    std::mt19937 random(7);
+    for (int i = 0; i < 3000; i++)
+    {
+        std::string k = "tenant-" + std::to_string(random() % 5) + "/projects/" + std::to_string(random() % 400);
+        expected[k] = i;
+        t.insert_or_assign(k, i);
+    }
+
+    std::vector<std::pair<std::string, int>> entries(expected.begin(), expected.end());
+    ASSERT_EQ(entries, t.dump());
+
+    for (const auto & entry : expected)
+    {
+        ASSERT_EQ(entry.second, t.get(entry.first));
+        ASSERT_FALSE(t.contains(entry.first + "/"));
+        ASSERT_EQ(entry.first, t.lower_bound(entry.first)->key);
+    }
+    ASSERT_FALSE(t.contains("tenant-"));
+    // same length as stored keys, differing inside the prefix their leaf shares
+    for (const auto & entry : expected)
+    {
+        std::string k = entry.first;
+        k[0] = 'u';
+        ASSERT_FALSE(t.contains(k));
+        k = entry.first;
+        k[k.find('/') + 1] = 'q';
+        ASSERT_EQ(nullptr, t.find(k));
+    }
+    ASSERT_EQ(expected.begin()->first, t.upper_bound("tenant-")->key);
+
+    std::vector<std::string> scanned;
+    t.scan("tenant-2/", "tenant-3/", [&scanned] (tree_t::reference entry) {
+        entry.value = -1;
+        scanned.push_back(entry.key);
+    });
+    auto first = expected.lower_bound("tenant-2/");
+    auto last = expected.lower_bound("tenant-3/");
+    ASSERT_EQ(std::distance(first, last), scanned.size());
+    ASSERT_EQ(first->first, scanned.front());
+    ASSERT_EQ(-1, t.get(scanned.back()));
+}
+
+TEST(BplusTree, prefixCompressedLeavesTellKeysApartInsideThePrefix) {
+    BplusTree<std::string, int, 8, prefix_compressed_layout> t;
+    t.add("abc", 1);
+    t.add("abd", 2);
+
+    ASSERT_FALSE(t.contains("aac"));
+    ASSERT_EQ(nullptr, t.find("aac"));
+    t.add("aac", 3);
+    ASSERT_EQ(3, t.get("aac"));
+    ASSERT_EQ(1, t.get("abc"));
+}
+
+TEST(BplusTree, moveAndClear) {
+    BplusTree<int, std::string, 2> t;
+    for (int i = 0; i < 100; i++)
+    {
+        t.add(i, "hello");
+    }
+
+    BplusTree<int, std::string, 2> moved(std::move(t));
+    t.add(1, "world");
+
+    ASSERT_EQ(100, moved.dump().size());
+    ASSERT_EQ(1, t.dump().size());
+
+    moved.clear();
+    moved.add(5, "again");
+    ASSERT_EQ(1, moved.dump().size());
+    ASSERT_EQ(1, moved.height());
+}
+
+// CountingAllocator does not propagate, trees counting into different counters move their entries
+TEST(BplusTree, moveAssignmentAndSwapKeepTheAllocators) {
+    using allocator_t = CountingAllocator<char>;
+    using tree_t = BplusTree<int, std::string, 3, interleaved_layout, default_search, allocator_t>;
+    AllocationCounter first_counter;
+    AllocationCounter second_counter;
+
+    {
+        tree_t first{allocator_t(&first_counter)};
+        tree_t second{allocator_t(&second_counter)};
+        for (int i = 0; i < 100; i++)
+        {
+            first.add(i, "first");
+            second.add(-i, "second");
+        }
+        second.add(1000, "second");
+
+        first.swap(second);
+        ASSERT_EQ(&first_counter, first.get_allocator().counter);
+        ASSERT_EQ(&second_counter, second.get_allocator().counter);
+        ASSERT_EQ(101, first.dump().size());
+        ASSERT_EQ("second", first.get(1000));
+        ASSERT_EQ(100, second.dump().size());
+        ASSERT_EQ("first", second.get(99));
+
+        first = std::move(second);
+        ASSERT_EQ(&first_counter, first.get_allocator().counter);
+        ASSERT_EQ(100, first.dump().size());
+        ASSERT_EQ("first", first.get(99));
+        ASSERT_EQ(0, second.dump().size());
+
+        second.add(5, "again");
+        ASSERT_EQ(1, second.dump().size());
+    }
+
+    ASSERT_EQ(first_counter.allocations, first_counter.deallocations);
+    ASSERT_EQ(second_counter.allocations, second_counter.deallocations);
+}
+
+TEST(BplusTree, nodesAreAllocatedWithTheAllocatorOfTheTree) {
+    AllocationCounter counter;
+    {
+        using allocator_t = CountingAllocator<char>;
+        BplusTree<int, std::string, 3, interleaved_layout, default_search, allocator_t> t{allocator_t(&counter)};
+        for (int i = 0; i < 1000; i++)
+        {
+            t.add(i, "hello");
+        }
+
+        ASSERT_GT(counter.allocations, 2);
+    }
+
+    ASSERT_EQ(counter.allocations, counter.deallocations);
+    ASSERT_EQ(counter.allocated_bytes, counter.deallocated_bytes);
+}
+
+#endif
@@ -1,272 +1,1195 @@
 #ifndef BTREE_H_
 #define BTREE_H_
 
-#include<functional>
+#include<cstddef>
+#include<iterator>
+#include<memory>
+#include<new>
+#include<type_traits>
+#include<typeinfo>
+#include<utility>
+#if __cplusplus >= 201703L
+#include<memory_resource>
+#endif
 
 #include "keys/keys.hpp"
+#include "keys/path.hpp"
+#include "pool/pool.hpp"
 
 
 namespace btree
 {
-    class duplicated_key_exception: public std::exception
+    // Insertion modes of Btree::add.
+    // bottom_up_split adds the key to its leaf and splits the overflowing nodes on the way back to the root.
+    // top_down_split splits every full node on the way down, so an insert visits each node once and never
+    // goes back to an ancestor. It needs a degree of at least 3 to split a full node into two non-empty halves.
+    struct bottom_up_split {};
+    struct top_down_split {};
+
+
+    // What a walk does after a visitor returned it. A visitor may also return bool, where false stops the walk,
+    // or nothing, then the walk visits every entry.
+    enum class walk_control
     {
-    public:
-        virtual const char* what() const noexcept override
-        {
-            return "duplicated key";
-        }
+        proceed,
+        // preorder_walk does not enter the children of the node of the entry,
+        // inorder_walk does not enter the child right of the entry, postorder_walk ignores it
+        skip_subtree,
+        stop
     };
 
 
-    template <typename KEY, typename VALUE, size_t DEGREE>
+    template <typename KEY, typename VALUE, size_t DEGREE,
+              typename LAYOUT = interleaved_layout, typename SEARCH = default_search,
+              typename ALLOCATOR = std::allocator<char>>
     class Btree
     {
     public:
         static const size_t degree = DEGREE;
         using key_t = KEY;
         using value_t = VALUE;
+        using layout_t = LAYOUT;
+        using search_t = SEARCH;
+        using allocator_t = ALLOCATOR;
+        using reference = KeyValueRef<KEY, VALUE>;
+        using const_reference = KeyValueRef<KEY, const VALUE>;
+
+        // Bidirectional iterator over the entries in key order. It dereferences to the entry in its node,
+        // moves along the parent pointers without a stack and stays valid until the tree is modified.
+        template<bool IS_CONST>
+        class Iterator
+        {
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = std::pair<KEY, VALUE>;
+            using difference_type = std::ptrdiff_t;
+            using reference = typename std::conditional<IS_CONST, const_reference, Btree::reference>::type;
+
+            // the entry is a proxy, operator-> has to return something which holds it
+            struct pointer
+            {
+                reference entry;
+
+                const reference* operator->() const noexcept
+                {
+                    return &entry;
+                }
+            };
+
+            Iterator() = default;
+
+            template<bool OTHER_IS_CONST, typename = typename std::enable_if<IS_CONST || !OTHER_IS_CONST>::type>
+            Iterator(const Iterator<OTHER_IS_CONST> & other) noexcept
+                : tree(other.tree), node(other.node), pos(other.pos) {}
+
+            reference operator*() const noexcept
+            {
+                return reference(node->keys.key(pos), node->keys.value(pos));
+            }
+
+            pointer operator->() const noexcept
+            {
+                return pointer{**this};
+            }
+
+            Iterator & operator++() noexcept
+            {
+                if (!node->keys.is_leaf())
+                {
+                    node = node->keys.get_child(pos + 1)->leftmost_leaf();
+                    pos = 0;
+
+                    return *this;
+                }
+
+                if (++pos < node->keys.size())
+                {
+                    return *this;
+                }
+
+                // the next entry is the separator right of the first ancestor which is not a last child
+                for (Btree* n = node; n->parent != nullptr; n = n->parent)
+                {
+                    size_t i = n->parent->keys.lower_bound(n->keys.key(0));
+                    if (i < n->parent->keys.size())
+                    {
+                        node = n->parent;
+                        pos = i;
+
+                        return *this;
+                    }
+                }
+
+                node = nullptr;
+                pos = 0;
+
+                return *this;
+            }
+
+            Iterator & operator--() noexcept
+            {
+                if (node == nullptr)
+                {
+                    node = tree->rightmost_leaf();
+                    pos = node->keys.size() - 1;
+
+                    return *this;
+                }
+
+                if (!node->keys.is_leaf())
+                {
+                    node = node->keys.get_child(pos)->rightmost_leaf();
+                    pos = node->keys.size() - 1;
+
+                    return *this;
+                }
+
+                if (pos > 0)
+                {
+                    pos--;
+
+                    return *this;
+                }
+
+                for (Btree* n = node; n->parent != nullptr; n = n->parent)
+                {
+                    size_t i = n->parent->keys.lower_bound(n->keys.key(0));
+                    if (i > 0)
+                    {
+                        node = n->parent;
+                        pos = i - 1;
+
+                        return *this;
+                    }
+                }
+
+                return *this;
+            }
+
+            Iterator operator++(int) noexcept
+            {
+                Iterator old = *this;
+                ++(*this);
+
+                return old;
+            }
+
+            Iterator operator--(int) noexcept
+            {
+                Iterator old = *this;
+                --(*this);
+
+                return old;
+            }
+
+            friend bool operator==(const Iterator & a, const Iterator & b) noexcept
+            {
+                return a.node == b.node && a.pos == b.pos;
+            }
+
+            friend bool operator!=(const Iterator & a, const Iterator & b) noexcept
+            {
+                return !(a == b);
+            }
+
+        private:
+            friend class Btree;
+            template<bool> friend class Iterator;
+
+            Btree* tree = nullptr;
+            // nullptr past the last entry
+            Btree* node = nullptr;
+            size_t pos = 0;
+
+            Iterator(Btree* tree, Btree* node, size_t pos) noexcept: tree(tree), node(node), pos(pos) {}
+        };
+
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
     private:
         friend class Keys<Btree>;
 
+        using KV = KeyValue<key_t, value_t>;
         using KV_pair = std::pair<key_t, value_t>;
+        using allocator_traits = std::allocator_traits<ALLOCATOR>;
+        // entries buffered outside of the nodes come from the allocator of the tree too
+        using entries_t = std::vector<KV, typename allocator_traits::template rebind_alloc<KV>>;
+
+        // a node holds nothing else which would need its destructor to run, so a tree with such keys and
+        // values is dropped by releasing its pool, unless a derived tree creates its nodes (see drops_children)
+        static const bool nodes_are_trivially_destructible =
+            std::is_trivially_destructible<KEY>::value && std::is_trivially_destructible<VALUE>::value;
 
         Btree* parent = nullptr;
 
     protected:
+        using pool_t = NodePool<ALLOCATOR>;
+
+        // shared by all nodes of the tree, owned by the root
+        pool_t* pool = nullptr;
+
         Keys<Btree> keys;
 
-        Btree(const Keys<Btree> ks)
-        {
-            keys = ks;
-            keys.set_owner(this);
-        }
+        Btree(pool_t* pool): pool(pool), keys(this) {}
 
-        virtual Btree* new_node(const Keys<Btree> ks)
+        virtual Btree* new_node(pool_t* pool)
         {
-            return new Btree(ks);
+            return new (pool->allocate(sizeof(Btree))) Btree(pool);
         }
 
     public:
-        Btree()
+        explicit Btree(const ALLOCATOR & allocator = ALLOCATOR()): pool(create_pool(allocator)), keys(this) {}
+
+        Btree(const Btree & other)
+            : Btree(other, allocator_traits::select_on_container_copy_construction(other.get_allocator()))
         {
-            keys = Keys<Btree>(degree, this);
         }
 
-        Btree(const Btree & other)
+        // copies the entries of other into nodes taken from allocator
+        Btree(const Btree & other, const ALLOCATOR & allocator): pool(create_pool(allocator))
         {
             keys = other.keys;
             for (auto it = keys.children_begin(); it != keys.children_end(); it++)
             {
                 (*it) = (*it)->copy(this);
             }
+            keys.set_owner(this);
         }
 
-        Btree(Btree && other) = default;
+        // Builds the tree from the entries of [first, last), see bulk_load.
+        // The nodes are created by this class, derived trees should call bulk_load after construction.
+        template<typename ITERATOR>
+        Btree(ITERATOR first, ITERATOR last, const double fill_factor = 1.0, const ALLOCATOR & allocator = ALLOCATOR())
+            : Btree(allocator)
+        {
+            bulk_load(first, last, fill_factor);
+        }
 
-        Btree & operator=(Btree copy_of_other)
+        // the nodes move together with the pool they live in, the moved-from tree gets a new one
+        Btree(Btree && other): pool(other.pool), keys(std::move(other.keys))
         {
-            std::swap(this, copy_of_other);
+            keys.set_owner(this);
+            other.keys.clear();
+            other.pool = create_pool(pool->get_allocator());
+        }
+
+        // The copy takes the allocator of other only if the allocator propagates on copy assignment,
+        // otherwise it is built in a pool with the allocator of this tree.
+        Btree & operator=(const Btree & other)
+        {
+            if (this != &other)
+            {
+                Btree copy(other, allocator_traits::propagate_on_container_copy_assignment::value
+                    ? other.get_allocator() : get_allocator());
+                swap_nodes(copy);
+            }
 
             return *this;
         }
 
-        void add(const key_t k, const value_t v)
+        // The nodes of other are taken along with their pool if the allocator propagates on move
+        // assignment or both allocators are equal, otherwise the entries are moved into this tree's pool.
+        Btree & operator=(Btree && other)
+        {
+            if (this == &other)
+            {
+                return *this;
+            }
+
+            if (allocator_traits::propagate_on_container_move_assignment::value || get_allocator() == other.get_allocator())
+            {
+                swap_nodes(other);
+                other.clear();
+
+                return *this;
+            }
+
+            entries_t entries = other.take_entries();
+            clear();
+            bulk_load(std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+
+            return *this;
+        }
+
+        // Like operator= the pools are exchanged only if the allocator propagates on swap or both
+        // allocators are equal, otherwise the entries move between the pools.
+        void swap(Btree & other)
+        {
+            if (allocator_traits::propagate_on_container_swap::value || get_allocator() == other.get_allocator())
+            {
+                swap_nodes(other);
+
+                return;
+            }
+
+            entries_t mine = take_entries();
+            entries_t theirs = other.take_entries();
+            bulk_load(std::make_move_iterator(theirs.begin()), std::make_move_iterator(theirs.end()));
+            other.bulk_load(std::make_move_iterator(mine.begin()), std::make_move_iterator(mine.end()));
+        }
+
+        ALLOCATOR get_allocator() const
         {
-            auto n = get_leaf_for_key(k);
-            auto kv = KeyValue<key_t, value_t>(k, v);
+            return pool->get_allocator();
+        }
+
+        // The entry is built once from k and v, rvalues are moved into it, lvalues are copied.
+        // Then it is moved into its node, splits move it again.
+        template<typename K, typename V, typename SPLIT = bottom_up_split>
+        void add(K && k, V && v, SPLIT split = SPLIT())
+        {
+            add_entry(KV(std::forward<K>(k), std::forward<V>(v)), split);
+        }
+
+        // Builds the entry from a key and a value or from a std::pair, like add it throws
+        // duplicated_key_exception if the key is present.
+        template<typename... ARGS>
+        void emplace(ARGS &&... args)
+        {
+            add_entry(KV(std::forward<ARGS>(args)...), bottom_up_split());
+        }
+
+        // Adds k with a value built from args if k is not present yet. Returns false and builds
+        // nothing if it is.
+        template<typename... ARGS>
+        bool try_emplace(const key_t & k, ARGS &&... args)
+        {
+            return try_emplace_key(k, std::forward<ARGS>(args)...);
+        }
+
+        template<typename... ARGS>
+        bool try_emplace(key_t && k, ARGS &&... args)
+        {
+            return try_emplace_key(std::move(k), std::forward<ARGS>(args)...);
+        }
+
+        // Assigns v to k if k is present, adds them otherwise. Returns true if k was added.
+        template<typename V>
+        bool insert_or_assign(const key_t & k, V && v)
+        {
+            Path path;
+            if (find_path_to_key(k, path))
+            {
+                found_value(path) = std::forward<V>(v);
+
+                return false;
+            }
+
+            add_along_path(path, Branch<Btree>(KV(k, std::forward<V>(v))));
+
+            return true;
+        }
+
+        // Calls update with the value of k. A missing k gets a value_t() which is updated before it is added.
+        // Returns true if k was added.
+        template<typename UPDATE>
+        bool upsert(const key_t & k, UPDATE update)
+        {
+            Path path;
+            if (find_path_to_key(k, path))
+            {
+                update(found_value(path));
+
+                return false;
+            }
+
+            value_t v = value_t();
+            update(v);
+            add_along_path(path, Branch<Btree>(KV(k, std::move(v))));
+
+            return true;
+        }
+
+        // Loads the std::pair or KeyValue entries of [first, last) into the tree.
+        // Sorted input is streamed into the nodes bottom-up, every node is filled up to fill_factor * degree
+        // keys, without searching or splitting. Unsorted input and loading into a non-empty tree first copy
+        // and sort the entries. Throws duplicated_key_exception before changing the tree if a key repeats.
+        // The range is read more than once (checked for order, counted, loaded), so it has to be forward.
+        template<typename ITERATOR>
+        void bulk_load(ITERATOR first, ITERATOR last, const double fill_factor = 1.0)
+        {
+            static_assert(std::is_base_of<std::forward_iterator_tag,
+                typename std::iterator_traits<ITERATOR>::iterator_category>::value,
+                "bulk_load reads the entries more than once, it needs forward iterators");
+
+            if (keys.size() == 0 && std::adjacent_find(first, last, IsNotIncreasing()) == last)
+            {
+                build_from_sorted(first, std::distance(first, last), fill_factor);
+
+                return;
+            }
+
+            entries_t entries(first, last, get_allocator());
+            std::sort(entries.begin(), entries.end());
 
-            if (n->keys.size() < degree)
+            if (std::adjacent_find(entries.begin(), entries.end()) != entries.end())
             {
-                n->keys.add(Branch<Btree>(kv));
+                BTREE_THROW(duplicated_key_exception());
             }
-            else
+
+            for (const KV & kv : entries)
             {
-                n->upwards_add(Branch<Btree>(kv));
+                Path path;
+                if (find_path_to_key(kv.key, path))
+                {
+                    BTREE_THROW(duplicated_key_exception());
+                }
             }
+
+            // nothing can fail from here, the values of the tree are moved out instead of copied
+            size_t loaded = entries.size();
+            inorder_walk([&entries] (reference entry) {
+                entries.push_back(KV(entry.key, std::move(entry.value)));
+            });
+            std::inplace_merge(entries.begin(), entries.begin() + loaded, entries.end());
+
+            clear();
+            build_from_sorted(std::make_move_iterator(entries.begin()), entries.size(), fill_factor);
         }
 
-        value_t & get(const key_t k)
+        void clear() noexcept
         {
-            auto value = keys.find_and_get_value(k);
-            if (value.is_present)
+            for (auto it = keys.children_begin(); it != keys.children_end(); it++)
             {
-                return value;
+                (*it)->clear();
+                (*it)->destroy();
             }
 
-            if (keys.is_leaf())
+            keys.clear();
+        }
+
+        value_t & get(const key_t & k)
+        {
+            value_t* value = find(k);
+            if (value == nullptr)
             {
-                throw key_does_not_exist_exception();
+                BTREE_THROW(key_does_not_exist_exception());
             }
 
-            return keys.select_child_for_key(k)->get(k);
+            return *value;
+        }
+
+        // Lookups which report a miss without throwing, they search every node on the path once.
+        value_t* find(const key_t & k) noexcept
+        {
+            Btree* n = this;
+            while (true)
+            {
+                size_t pos = n->keys.lower_bound(k);
+                if (n->keys.is_key_at(pos, k))
+                {
+                    return &n->keys.value(pos);
+                }
+
+                if (n->keys.is_leaf())
+                {
+                    return nullptr;
+                }
+
+                n = n->keys.get_child(pos);
+            }
+        }
+
+        const value_t* find(const key_t & k) const noexcept
+        {
+            return const_cast<Btree*>(this)->find(k);
+        }
+
+        bool contains(const key_t & k) const noexcept
+        {
+            return find(k) != nullptr;
+        }
+
+        SearchedValue<value_t> try_get(const key_t & k) noexcept
+        {
+            value_t* value = find(k);
+
+            return SearchedValue<value_t>(value != nullptr, value);
+        }
+
+        iterator begin() noexcept
+        {
+            if (keys.size() == 0)
+            {
+                return end();
+            }
+
+            return iterator(this, leftmost_leaf(), 0);
+        }
+
+        iterator end() noexcept
+        {
+            return iterator(this, nullptr, 0);
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return const_cast<Btree*>(this)->begin();
+        }
+
+        const_iterator end() const noexcept
+        {
+            return const_cast<Btree*>(this)->end();
+        }
+
+        const_iterator cbegin() const noexcept
+        {
+            return begin();
+        }
+
+        const_iterator cend() const noexcept
+        {
+            return end();
+        }
+
+        reverse_iterator rbegin() noexcept
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() noexcept
+        {
+            return reverse_iterator(begin());
+        }
+
+        const_reverse_iterator rbegin() const noexcept
+        {
+            return const_reverse_iterator(end());
+        }
+
+        const_reverse_iterator rend() const noexcept
+        {
+            return const_reverse_iterator(begin());
+        }
+
+        const_reverse_iterator crbegin() const noexcept
+        {
+            return rbegin();
+        }
+
+        const_reverse_iterator crend() const noexcept
+        {
+            return rend();
+        }
+
+        // the first entry whose key is not less than k
+        iterator lower_bound(const key_t & k) noexcept
+        {
+            return bound(k, false);
+        }
+
+        // the first entry whose key is greater than k
+        iterator upper_bound(const key_t & k) noexcept
+        {
+            return bound(k, true);
+        }
+
+        const_iterator lower_bound(const key_t & k) const noexcept
+        {
+            return const_cast<Btree*>(this)->lower_bound(k);
+        }
+
+        const_iterator upper_bound(const key_t & k) const noexcept
+        {
+            return const_cast<Btree*>(this)->upper_bound(k);
+        }
+
+        // the entries with key k, the keys are unique so it is empty or holds one entry
+        std::pair<iterator, iterator> equal_range(const key_t & k) noexcept
+        {
+            iterator first = lower_bound(k);
+            iterator last = first;
+            if (first != end() && !(k < first->key))
+            {
+                ++last;
+            }
+
+            return std::make_pair(first, last);
+        }
+
+        std::pair<const_iterator, const_iterator> equal_range(const key_t & k) const noexcept
+        {
+            auto range = const_cast<Btree*>(this)->equal_range(k);
+
+            return std::make_pair(const_iterator(range.first), const_iterator(range.second));
+        }
+
+        // Calls visit with the entries whose key is in [lo, hi) in key order.
+        // Only the subtrees which can hold such keys are entered.
+        template<typename VISITOR>
+        void scan(const key_t & lo, const key_t & hi, VISITOR visit)
+        {
+            scan_node(lo, hi, visit);
         }
 
         std::vector<KV_pair> dump()
         {
             std::vector<KV_pair> result;
-            inorder_walk([&result] (KV_pair kv_pair) {
-                result.push_back(kv_pair);
+            inorder_walk([&result] (reference entry) {
+                result.push_back(entry);
             });
 
             return result;
         }
 
-        void inorder_walk(std::function<void(KV_pair)> on_visit)
+        // The walks hand the entries to the visitor in place, a visitor taking std::pair<key_t, value_t> gets a copy.
+        // On a const tree the visitor gets const_reference.
+        template<typename VISITOR>
+        void inorder_walk(VISITOR visit)
+        {
+            walk_inorder<reference>(visit);
+        }
+
+        template<typename VISITOR>
+        void inorder_walk(VISITOR visit) const
+        {
+            const_cast<Btree*>(this)->template walk_inorder<const_reference>(visit);
+        }
+
+        template<typename VISITOR>
+        void preorder_walk(VISITOR visit)
         {
-            if (!keys.is_leaf())
+            walk_preorder<reference>(visit);
+        }
+
+        template<typename VISITOR>
+        void preorder_walk(VISITOR visit) const
+        {
+            const_cast<Btree*>(this)->template walk_preorder<const_reference>(visit);
+        }
+
+        template<typename VISITOR>
+        void postorder_walk(VISITOR visit)
+        {
+            walk_postorder<reference>(visit);
+        }
+
+        template<typename VISITOR>
+        void postorder_walk(VISITOR visit) const
+        {
+            const_cast<Btree*>(this)->template walk_postorder<const_reference>(visit);
+        }
+
+        virtual ~Btree()
+        {
+            if (!drops_children())
             {
-                for (size_t i = 0; i < keys.size(); i++)
+                for (auto it = keys.children_begin(); it != keys.children_end(); it++)
                 {
-                    auto b = keys.get_branch(i);
-                    b.left->inorder_walk(on_visit);
-                    on_visit(b.kv);
+                    (*it)->destroy();
                 }
+            }
 
-                keys.get_rightmost_child()->inorder_walk(on_visit);
+            if (parent == nullptr)
+            {
+                destroy_pool(pool);
             }
-            else
+        }
+
+    private:
+        // The nodes of a derived tree may hold more than the keys and the values. Its type is not known
+        // any more in the destructor of this class, but the children are still whole and tell it.
+        bool drops_children() noexcept
+        {
+            return nodes_are_trivially_destructible
+                && (keys.is_leaf() || typeid(**keys.children_begin()) == typeid(Btree));
+        }
+
+        void swap_nodes(Btree & other) noexcept
+        {
+            std::swap(pool, other.pool);
+            std::swap(keys, other.keys);
+            keys.set_owner(this);
+            other.keys.set_owner(&other);
+        }
+
+        // moves the entries out in order and leaves the tree empty
+        entries_t take_entries()
+        {
+            entries_t entries(get_allocator());
+            inorder_walk([&entries] (reference entry) {
+                entries.push_back(KV(entry.key, std::move(entry.value)));
+            });
+            clear();
+
+            return entries;
+        }
+
+        void add_entry(KV && kv, bottom_up_split)
+        {
+            Path path;
+            if (find_path_to_key(kv.key, path))
+            {
+                BTREE_THROW(duplicated_key_exception());
+            }
+
+            add_along_path(path, Branch<Btree>(std::move(kv)));
+        }
+
+        // The nodes split before a duplicated key is found are left split, the entries of the tree do not change.
+        void add_entry(KV && kv, top_down_split)
+        {
+            static_assert(DEGREE >= 3, "top_down_split needs a degree of at least 3");
+
+            if (keys.size() == degree)
+            {
+                Btree* right = new_node(pool);
+                grow(keys.split(right->keys), right);
+            }
+
+            Btree* n = this;
+            while (true)
             {
-                for (size_t i = 0; i < keys.size(); i++)
+                size_t pos = n->keys.lower_bound(kv.key);
+                if (n->keys.is_key_at(pos, kv.key))
                 {
-                    on_visit(keys.get_branch(i).kv);
+                    BTREE_THROW(duplicated_key_exception());
                 }
+
+                if (n->keys.is_leaf())
+                {
+                    n->keys.insert(pos, Branch<Btree>(std::move(kv)));
+
+                    return;
+                }
+
+                Btree* child = n->keys.get_child(pos);
+                if (child->keys.size() == degree)
+                {
+                    // the parent is never full here, it has room for the median
+                    Btree* right = new_node(pool);
+                    auto median = child->keys.split(right->keys);
+                    bool goes_right = median.key < kv.key;
+                    bool is_duplicate = !goes_right && !(kv.key < median.key);
+                    n->keys.insert(pos, Branch<Btree>(std::move(median), child, right));
+
+                    if (is_duplicate)
+                    {
+                        BTREE_THROW(duplicated_key_exception());
+                    }
+
+                    if (goes_right)
+                    {
+                        child = right;
+                    }
+                }
+
+                n = child;
             }
         }
 
-        void preorder_walk(std::function<void(KV_pair)> on_visit)
+        template<typename K, typename... ARGS>
+        bool try_emplace_key(K && k, ARGS &&... args)
         {
+            Path path;
+            if (find_path_to_key(k, path))
+            {
+                return false;
+            }
+
+            add_along_path(path, Branch<Btree>(KV(std::forward<K>(k), value_t(std::forward<ARGS>(args)...))));
+
+            return true;
+        }
+
+        // the nodes visited from the root to a leaf and the position taken in each of them
+        using Path = NodePath<Btree>;
+
+        // Descends to the leaf where k belongs with one search per node. Returns true if k is already present,
+        // then the last step of the path is the node and the position of k.
+        bool find_path_to_key(const key_t & k, Path & path)
+        {
+            Btree* n = this;
+            while (true)
+            {
+                size_t pos = n->keys.lower_bound(k);
+                path.steps[path.length++] = typename Path::Step{n, pos};
+
+                if (n->keys.is_key_at(pos, k))
+                {
+                    return true;
+                }
+
+                if (n->keys.is_leaf())
+                {
+                    return false;
+                }
+
+                n = n->keys.get_child(pos);
+            }
+        }
+
+        // Separators passed on the way down are remembered, the last one left of which the search went is the
+        // bound if the leaf has no key after the position of k.
+        iterator bound(const key_t & k, const bool is_upper) noexcept
+        {
+            iterator result = end();
+            Btree* n = this;
+            while (true)
+            {
+                size_t pos = is_upper ? n->keys.upper_bound(k) : n->keys.lower_bound(k);
+                if (pos < n->keys.size())
+                {
+                    result = iterator(this, n, pos);
+
+                    if (!is_upper && !(k < n->keys.key(pos)))
+                    {
+                        return result;
+                    }
+                }
+
+                if (n->keys.is_leaf())
+                {
+                    return result;
+                }
+
+                n = n->keys.get_child(pos);
+            }
+        }
+
+        template<typename VISITOR>
+        void scan_node(const key_t & lo, const key_t & hi, VISITOR & visit)
+        {
+            for (size_t i = keys.lower_bound(lo); ; i++)
+            {
+                if (!keys.is_leaf())
+                {
+                    keys.get_child(i)->scan_node(lo, hi, visit);
+                }
+
+                if (i >= keys.size() || !(keys.key(i) < hi))
+                {
+                    return;
+                }
+
+                visit(keys.entry(i));
+            }
+        }
+
+        // the walks return false if the visitor stopped them
+        template<typename REFERENCE, typename VISITOR>
+        bool walk_inorder(VISITOR & visit)
+        {
+            bool skips_child = false;
+            for (size_t i = 0; i <= keys.size(); i++)
+            {
+                if (!keys.is_leaf() && !skips_child && !keys.get_child(i)->template walk_inorder<REFERENCE>(visit))
+                {
+                    return false;
+                }
+
+                if (i == keys.size())
+                {
+                    return true;
+                }
+
+                walk_control control = visit_entry(visit, REFERENCE(keys.key(i), keys.value(i)));
+                if (control == walk_control::stop)
+                {
+                    return false;
+                }
+                skips_child = control == walk_control::skip_subtree;
+            }
+
+            return true;
+        }
+
+        template<typename REFERENCE, typename VISITOR>
+        bool walk_preorder(VISITOR & visit)
+        {
+            bool skips_children = false;
             for (size_t i = 0; i < keys.size(); i++)
             {
-                on_visit(keys.get_branch(i).kv);
+                walk_control control = visit_entry(visit, REFERENCE(keys.key(i), keys.value(i)));
+                if (control == walk_control::stop)
+                {
+                    return false;
+                }
+                skips_children = skips_children || control == walk_control::skip_subtree;
+            }
+
+            if (skips_children)
+            {
+                return true;
             }
 
             for (auto it = keys.children_begin(); it != keys.children_end(); it++)
             {
-                (*it)->preorder_walk(on_visit);
+                if (!(*it)->template walk_preorder<REFERENCE>(visit))
+                {
+                    return false;
+                }
             }
+
+            return true;
         }
 
-        void postorder_walk(std::function<void(KV_pair)> on_visit)
+        template<typename REFERENCE, typename VISITOR>
+        bool walk_postorder(VISITOR & visit)
         {
             for (auto it = keys.children_begin(); it != keys.children_end(); it++)
             {
-                (*it)->postorder_walk(on_visit);
+                if (!(*it)->template walk_postorder<REFERENCE>(visit))
+                {
+                    return false;
+                }
             }
 
             for (size_t i = 0; i < keys.size(); i++)
             {
-                on_visit(keys.get_branch(i).kv);
+                if (visit_entry(visit, REFERENCE(keys.key(i), keys.value(i))) == walk_control::stop)
+                {
+                    return false;
+                }
             }
+
+            return true;
         }
 
-        virtual ~Btree()
+        template<typename VISITOR, typename REFERENCE>
+        static walk_control visit_entry(VISITOR & visit, REFERENCE entry)
         {
-            for (auto it = keys.children_begin(); it != keys.children_end(); it++)
+            return visit_entry(visit, entry, std::is_void<decltype(visit(entry))>());
+        }
+
+        template<typename VISITOR, typename REFERENCE>
+        static walk_control visit_entry(VISITOR & visit, REFERENCE entry, std::true_type /* returns void */)
+        {
+            visit(entry);
+
+            return walk_control::proceed;
+        }
+
+        template<typename VISITOR, typename REFERENCE>
+        static walk_control visit_entry(VISITOR & visit, REFERENCE entry, std::false_type /* returns void */)
+        {
+            return to_walk_control(visit(entry));
+        }
+
+        static walk_control to_walk_control(const bool proceeds) noexcept
+        {
+            return proceeds ? walk_control::proceed : walk_control::stop;
+        }
+
+        static walk_control to_walk_control(const walk_control control) noexcept
+        {
+            return control;
+        }
+
+        Btree* leftmost_leaf() noexcept
+        {
+            Btree* n = this;
+            while (!n->keys.is_leaf())
             {
-                delete *it;
+                n = n->keys.get_child(0);
             }
+
+            return n;
         }
 
-    private:
-        Btree* get_leaf_for_key(const key_t k)
+        Btree* rightmost_leaf() noexcept
         {
-            if (keys.is_present(k))
+            Btree* n = this;
+            while (!n->keys.is_leaf())
             {
-                throw duplicated_key_exception();
+                n = n->keys.get_rightmost_child();
             }
 
-            if (keys.is_leaf())
+            return n;
+        }
+
+        value_t & found_value(Path & path) noexcept
+        {
+            typename Path::Step & last = path.steps[path.length - 1];
+
+            return last.node->keys.value(last.pos);
+        }
+
+        // Adds the branch to the leaf at the end of the path. Nodes which become too big split in place
+        // and their median goes to the position of the path one level up.
+        void add_along_path(Path & path, Branch<Btree> branch)
+        {
+            for (size_t level = path.length; level-- > 0;)
             {
-                return this;
-            }
+                Btree* n = path.steps[level].node;
+                n->keys.insert(path.steps[level].pos, std::move(branch));
+
+                if (n->keys.size() <= degree)
+                {
+                    return;
+                }
+
+                Btree* right = new_node(pool);
+                auto median = n->keys.split(right->keys);
+
+                if (level == 0)
+                {
+                    grow(std::move(median), right);
 
-            return keys.select_child_for_key(k)->get_leaf_for_key(k);
+                    return;
+                }
+
+                branch = Branch<Btree>(std::move(median), n, right);
+            }
         }
 
-        void upwards_add(Branch<Btree> branch)
+        struct IsNotIncreasing
         {
-            if (keys.size() < degree)
+            static const key_t & key_of(const KV_pair & kv_pair) noexcept
             {
-                keys.add(branch);
+                return kv_pair.first;
+            }
 
-                return;
+            static const key_t & key_of(const KV & kv) noexcept
+            {
+                return kv.key;
             }
 
-            auto seperated = seperate_current_for_unfitting(branch);
+            template<typename ENTRY>
+            bool operator () (const ENTRY & a, const ENTRY & b) const
+            {
+                return !(key_of(a) < key_of(b));
+            }
+        };
 
-            if (parent == nullptr)
+        // bulk loaded nodes in one level of the tree
+        struct Level
+        {
+            size_t nodes;
+            size_t keys_per_node;
+            // the first this many nodes get one more key
+            size_t longer_nodes;
+            size_t finished_nodes;
+            Btree* node;
+
+            size_t keys_of_current_node() const noexcept
             {
-                grow(seperated);
+                return keys_per_node + (finished_nodes < longer_nodes ? 1 : 0);
             }
-            else
+        };
+
+        static size_t plan_levels(Level* levels, size_t entries, const double fill_factor) noexcept
+        {
+            assert(fill_factor > 0 && fill_factor <= 1);
+
+            size_t capacity = std::min(std::max(static_cast<size_t>(fill_factor * DEGREE), size_t(1)), DEGREE);
+            size_t height = 0;
+            size_t nodes;
+
+            do
             {
-                parent->upwards_add(seperated);
+                // a level of n nodes holds their keys and the n - 1 seperators which move up to the next level
+                nodes = std::min((entries + capacity + 1) / (capacity + 1), (entries + 1) / 2);
+                nodes = std::max(nodes, size_t(1));
+                size_t keys_in_nodes = entries - (nodes - 1);
 
-                remove_self();
+                levels[height++] = Level{nodes, keys_in_nodes / nodes, keys_in_nodes % nodes, 0, nullptr};
+                entries = nodes - 1;
             }
+            while (nodes > 1);
+
+            return height;
         }
 
-        Branch<Btree> seperate_current_for_unfitting(Branch<Btree> unfitting)
+        template<typename ITERATOR>
+        void build_from_sorted(ITERATOR first, const size_t size, const double fill_factor)
         {
-            auto median = keys.get_median_KV_with_new_key(unfitting.kv);
-            Branch<Btree> seperated(median);
-            auto left_branch_keys = keys.get_left_half_of_keys();
-            auto right_branch_keys = keys.get_right_half_of_keys();
+            if (size == 0)
+            {
+                return;
+            }
 
-            if (median == unfitting.kv && unfitting.has_children())
+            Level levels[max_height];
+            size_t height = plan_levels(levels, size, fill_factor);
+            levels[height - 1].node = this;
+
+            for (size_t i = 0; i < size; i++, ++first)
             {
-                assert(left_branch_keys.get_last_branch().right == right_branch_keys.get_first_branch().left);
+                place_sorted(levels, 0, KV(*first), nullptr);
+            }
 
-                auto left_last_branch = left_branch_keys.get_last_branch();
-                left_last_branch.right = unfitting.left;
-                left_branch_keys.change_last_to(left_last_branch);
+            for (size_t i = 0; i + 1 < height; i++)
+            {
+                levels[i + 1].node->keys.append_child(levels[i].node);
+            }
+        }
 
-                auto right_first_branch = right_branch_keys.get_first_branch();
-                right_first_branch.left = unfitting.right;
-                right_branch_keys.change_first_to(right_first_branch);
+        // the entry is the next one in order, child is the finished node of the level below which precedes it
+        void place_sorted(Level* levels, const size_t i, KV && kv, Btree* child)
+        {
+            Level & level = levels[i];
+
+            if (level.node == nullptr)
+            {
+                level.node = new_node(pool);
             }
-            else if (median < unfitting.kv)
+
+            if (child != nullptr)
             {
-                right_branch_keys.change_first_to(unfitting);
+                level.node->keys.append_child(child);
             }
-            else if (median > unfitting.kv)
+
+            if (level.node->keys.size() < level.keys_of_current_node())
             {
-                left_branch_keys.change_last_to(unfitting);
+                level.node->keys.append(std::move(kv));
+
+                return;
             }
 
-            seperated.left = new_node(left_branch_keys);
-            seperated.right = new_node(right_branch_keys);
+            Btree* finished = level.node;
+            level.node = nullptr;
+            level.finished_nodes++;
 
-            return seperated;
+            place_sorted(levels, i + 1, std::move(kv), finished);
         }
 
-        void grow(Branch<Btree> new_root)
+        // the root stays the root, its keys move down to a new left child
+        void grow(KV && median, Btree* right)
         {
-            keys.clear();
-            keys.add(new_root);
+            Btree* left = new_node(pool);
+            keys.move_to(left->keys);
+            keys.add(Branch<Btree>(std::move(median), left, right));
         }
 
-        void remove_self() noexcept
+        // counterpart of new_node for the nodes below the root
+        void destroy() noexcept
         {
-            keys.clear();
-            delete this;
+            pool_t* node_pool = pool;
+            void* memory = dynamic_cast<void*>(this);
+
+            this->~Btree();
+            node_pool->release(memory);
         }
 
         Btree* copy(Btree* parent)
         {
-            auto copy = new_node(keys);
+            auto copy = new_node(parent->pool);
             copy->parent = parent;
+            copy->keys = keys;
 
-            for (auto it = keys.children_begin(); it != keys.children_end(); it++)
+            for (auto it = copy->keys.children_begin(); it != copy->keys.children_end(); it++)
             {
                 (*it) = (*it)->copy(copy);
             }
+            copy->keys.set_owner(copy);
 
             return copy;
         }
 
     };
 
+#if __cplusplus >= 201703L
+    namespace pmr
+    {
+        // Btree which takes its nodes from a memory resource, e.g. a std::pmr::monotonic_buffer_resource
+        // for trees which live as long as a request
+        template <typename KEY, typename VALUE, size_t DEGREE,
+                  typename LAYOUT = interleaved_layout, typename SEARCH = default_search>
+        using Btree = btree::Btree<KEY, VALUE, DEGREE, LAYOUT, SEARCH, std::pmr::polymorphic_allocator<char>>;
+    }
+#endif
 }
 #endif
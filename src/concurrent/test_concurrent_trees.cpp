@@ -0,0 +1 @@
+#include "test_concurrent_trees.hpp"
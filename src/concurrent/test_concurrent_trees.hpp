@@ -0,0 +1,138 @@
+#ifndef TEST_CONCURRENT_TREES_H_
+#define TEST_CONCURRENT_TREES_H_
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "blink/blink_tree.hpp"
+#include "olc/olc_btree.hpp"
+#include "snapshot/snapshot_btree.hpp"
+
+
+using namespace btree;
+
+// the vendored gtest predates TYPED_TEST_SUITE
+#ifndef TYPED_TEST_SUITE
+#define TYPED_TEST_SUITE TYPED_TEST_CASE
+#endif
+
+// The checks every concurrent tree has to pass with a single thread. The latched trees are read
+// directly, the snapshot tree through a fresh snapshot.
+template<typename TREE>
+struct LatchedReads
+{
+    using tree_t = TREE;
+
+    TREE tree;
+
+    TREE & view()
+    {
+        return tree;
+    }
+};
+
+template<typename TREE>
+struct SnapshotReads
+{
+    using tree_t = TREE;
+
+    TREE tree;
+    typename TREE::reader_t reader = tree.reader();
+
+    typename TREE::Snapshot view()
+    {
+        return tree.snapshot(reader);
+    }
+};
+
+struct olc_trees
+{
+    template<size_t DEGREE>
+    using fixture = LatchedReads<OlcBtree<int, int, DEGREE>>;
+};
+
+struct blink_trees
+{
+    template<size_t DEGREE>
+    using fixture = LatchedReads<BlinkTree<int, int, DEGREE>>;
+};
+
+struct snapshot_trees
+{
+    template<size_t DEGREE>
+    using fixture = SnapshotReads<SnapshotBtree<int, int, DEGREE>>;
+};
+
+template<typename TREES>
+class ConcurrentTrees: public ::testing::Test {};
+
+using concurrent_trees = ::testing::Types<olc_trees, blink_trees, snapshot_trees>;
+TYPED_TEST_SUITE(ConcurrentTrees, concurrent_trees);
+
+TYPED_TEST(ConcurrentTrees, addAndFind) {
+    for (size_t n = 0; n < 300; n += 13)
+    {
+        typename TypeParam::template fixture<3> t;
+        std::map<int, int> expected;
+        std::mt19937 random(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            int k = random() % 1000;
+            if (expected.insert(std::make_pair(k, -k)).second)
+            {
+                t.tree.add(k, -k);
+            }
+        }
+
+        auto && view = t.view();
+        std::vector<std::pair<int, int>> entries(expected.begin(), expected.end());
+        ASSERT_EQ(entries, view.dump());
+        for (int k = -1; k < 1001; k++)
+        {
+            ASSERT_EQ(expected.count(k) == 1, view.contains(k));
+            if (expected.count(k) == 1)
+            {
+                ASSERT_EQ(-k, view.get(k));
+            }
+        }
+    }
+}
+
+TYPED_TEST(ConcurrentTrees, duplicateKeyAndInsertOrAssign) {
+    typename TypeParam::template fixture<4> t;
+    for (int i = 0; i < 100; i++)
+    {
+        ASSERT_TRUE(t.tree.insert_or_assign(i, i));
+    }
+
+    ASSERT_THROW(t.tree.add(50, 0), duplicated_key_exception);
+    ASSERT_FALSE(t.tree.insert_or_assign(50, -50));
+    ASSERT_EQ(-50, t.view().get(50));
+    ASSERT_THROW(t.view().get(100), key_does_not_exist_exception);
+    ASSERT_GT(t.view().height(), 2);
+}
+
+TYPED_TEST(ConcurrentTrees, scan) {
+    using fixture_t = typename TypeParam::template fixture<5>;
+    fixture_t t;
+    for (int i = 999; i >= 0; i--)
+    {
+        t.tree.add(i * 2, i);
+    }
+
+    std::vector<int> scanned;
+    t.view().scan(501, 701, [&scanned] (typename fixture_t::tree_t::const_reference entry) {
+        scanned.push_back(entry.key);
+    });
+
+    ASSERT_EQ(100, scanned.size());
+    ASSERT_EQ(502, scanned.front());
+    ASSERT_EQ(700, scanned.back());
+    ASSERT_TRUE(std::is_sorted(scanned.begin(), scanned.end()));
+}
+
+#endif
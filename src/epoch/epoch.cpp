@@ -0,0 +1,8 @@
+#include "epoch.hpp"
+
+
+namespace btree
+{
+    const size_t EpochManager::max_participants;
+    const size_t EpochManager::collect_threshold;
+}
@@ -0,0 +1,280 @@
+#ifndef EPOCH_H_
+#define EPOCH_H_
+
+#include<algorithm>
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+#include<exception>
+#include<mutex>
+#include<utility>
+#include<vector>
+
+#include "keys/keys.hpp"
+
+
+namespace btree
+{
+    class too_many_participants_exception: public std::exception
+    {
+    public:
+        virtual const char* what() const noexcept override
+        {
+            return "too many participants of the epoch manager";
+        }
+    };
+
+
+    // Epoch based reclamation of nodes which readers may still be looking at.
+    // Every thread which reads or retires nodes registers a Participant. A reader pins the current epoch
+    // while it holds pointers to nodes, which is a load and a store to its own slot, no read-modify-write.
+    // A node unlinked from the tree is retired to the limbo list of the participant which unlinked it,
+    // tagged with the epoch of that moment. The epoch moves on only when every pinned participant has seen
+    // it, so two epochs later no reader can hold the node any more and it is reclaimed.
+    class EpochManager
+    {
+    public:
+        static const size_t max_participants = 128;
+        // a participant tries to reclaim its limbo list after this many retired nodes
+        static const size_t collect_threshold = 64;
+
+        using reclaim_t = void (*)(void* object, void* context);
+
+    private:
+        // a pinned slot holds the epoch it was pinned at, 0 means not pinned
+        struct Slot
+        {
+            std::atomic<uint64_t> epoch{0};
+            std::atomic<bool> taken{false};
+            // slots of different threads are not in the same cache line
+            char padding[64 - sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<bool>)];
+        };
+
+        struct Retired
+        {
+            void* object;
+            reclaim_t reclaim;
+            void* context;
+            uint64_t epoch;
+        };
+
+        std::atomic<uint64_t> global_epoch{1};
+        Slot slots[max_participants];
+        // the limbo lists of the participants which went away before all of their nodes were reclaimed
+        std::mutex orphans_mutex;
+        std::vector<Retired> orphans;
+
+    public:
+        class Participant;
+
+        // Keeps the epoch of a participant pinned while it exists.
+        class Guard
+        {
+        public:
+            Guard(Guard && other) noexcept: participant(other.participant)
+            {
+                other.participant = nullptr;
+            }
+
+            Guard(const Guard &) = delete;
+            Guard & operator=(const Guard &) = delete;
+
+            ~Guard()
+            {
+                if (participant != nullptr)
+                {
+                    participant->unpin();
+                }
+            }
+
+        private:
+            friend class Participant;
+
+            Participant* participant;
+
+            explicit Guard(Participant* participant) noexcept: participant(participant) {}
+        };
+
+        // The registration of one thread, it is used by that thread only.
+        class Participant
+        {
+        private:
+            EpochManager* manager;
+            Slot* slot;
+            size_t pins = 0;
+            size_t retired_since_collect = 0;
+            std::vector<Retired> limbo;
+
+        public:
+            // Throws too_many_participants_exception if all slots are taken.
+            explicit Participant(EpochManager & manager): manager(&manager), slot(manager.take_slot()) {}
+
+            Participant(Participant && other) noexcept
+                : manager(other.manager), slot(other.slot), pins(other.pins),
+                  retired_since_collect(other.retired_since_collect), limbo(std::move(other.limbo))
+            {
+                other.slot = nullptr;
+            }
+
+            Participant(const Participant &) = delete;
+            Participant & operator=(const Participant &) = delete;
+
+            // Pins the current epoch, pins nest. The nodes reached while the guard exists are not reclaimed.
+            Guard pin() noexcept
+            {
+                if (pins++ == 0)
+                {
+                    slot->epoch.store(manager->global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                }
+
+                return Guard(this);
+            }
+
+            // object is unlinked already, reclaim(object, context) is called once nobody can reach it.
+            // reclaim runs on the thread of a participant of this manager, or in the destructor of the manager.
+            void retire(void* object, reclaim_t reclaim, void* context = nullptr)
+            {
+                limbo.push_back(Retired{object, reclaim, context, manager->global_epoch.load(std::memory_order_seq_cst)});
+                if (++retired_since_collect == collect_threshold)
+                {
+                    collect();
+                }
+            }
+
+            template<typename T>
+            void retire(T* object)
+            {
+                retire(object, [] (void* o, void*) { delete static_cast<T*>(o); });
+            }
+
+            // Moves the epoch on if it can and reclaims the nodes retired two epochs ago or earlier.
+            void collect()
+            {
+                retired_since_collect = 0;
+                manager->try_advance();
+                uint64_t epoch = manager->global_epoch.load(std::memory_order_seq_cst);
+                reclaim_before(limbo, epoch);
+                manager->collect_orphans(epoch);
+            }
+
+            // number of retired nodes which are not reclaimed yet
+            size_t pending() const noexcept
+            {
+                return limbo.size();
+            }
+
+            ~Participant()
+            {
+                if (slot == nullptr)
+                {
+                    return;
+                }
+
+                slot->epoch.store(0, std::memory_order_seq_cst);
+                collect();
+                manager->adopt(limbo);
+                slot->taken.store(false, std::memory_order_release);
+            }
+
+        private:
+            friend class Guard;
+
+            void unpin() noexcept
+            {
+                if (--pins == 0)
+                {
+                    slot->epoch.store(0, std::memory_order_release);
+                }
+            }
+        };
+
+        EpochManager() = default;
+        EpochManager(const EpochManager &) = delete;
+        EpochManager & operator=(const EpochManager &) = delete;
+
+        uint64_t epoch() const noexcept
+        {
+            return global_epoch.load(std::memory_order_seq_cst);
+        }
+
+        // the participants are gone, everything left is reclaimed
+        ~EpochManager()
+        {
+            for (Retired & retired : orphans)
+            {
+                retired.reclaim(retired.object, retired.context);
+            }
+        }
+
+    private:
+        Slot* take_slot()
+        {
+            for (Slot & slot : slots)
+            {
+                bool taken = false;
+                if (!slot.taken.load(std::memory_order_relaxed)
+                    && slot.taken.compare_exchange_strong(taken, true, std::memory_order_acquire))
+                {
+                    return &slot;
+                }
+            }
+
+            BTREE_THROW(too_many_participants_exception());
+        }
+
+        // the epoch moves on if every pinned participant is in the current one
+        void try_advance() noexcept
+        {
+            uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+            for (const Slot & slot : slots)
+            {
+                uint64_t pinned = slot.epoch.load(std::memory_order_seq_cst);
+                if (pinned != 0 && pinned != epoch)
+                {
+                    return;
+                }
+            }
+
+            global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+        }
+
+        // a node retired in epoch e may be reached by readers pinned at e, from e + 2 on there are none
+        static void reclaim_before(std::vector<Retired> & retired, const uint64_t epoch)
+        {
+            auto reclaimable = std::stable_partition(retired.begin(), retired.end(), [epoch] (const Retired & r) {
+                return r.epoch + 2 > epoch;
+            });
+
+            for (auto it = reclaimable; it != retired.end(); ++it)
+            {
+                it->reclaim(it->object, it->context);
+            }
+            retired.erase(reclaimable, retired.end());
+        }
+
+        void adopt(std::vector<Retired> & limbo)
+        {
+            if (limbo.empty())
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(orphans_mutex);
+            orphans.insert(orphans.end(), limbo.begin(), limbo.end());
+            limbo.clear();
+        }
+
+        // a participant which finds the orphans locked leaves them to the next one
+        void collect_orphans(const uint64_t epoch)
+        {
+            std::unique_lock<std::mutex> lock(orphans_mutex, std::try_to_lock);
+            if (lock.owns_lock() && !orphans.empty())
+            {
+                reclaim_before(orphans, epoch);
+            }
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef TEST_EPOCH_H_
+#define TEST_EPOCH_H_
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "epoch/epoch.hpp"
+
+
+using namespace btree;
+
+namespace
+{
+    void delete_and_count(void* object, void* reclaimed)
+    {
+        delete static_cast<int*>(object);
+        ++*static_cast<int*>(reclaimed);
+    }
+}
+
+TEST(Epoch, retiredObjectsAreReclaimedTwoEpochsLater) {
+    EpochManager manager;
+    EpochManager::Participant participant(manager);
+    int reclaimed = 0;
+
+    participant.retire(new int(1), delete_and_count, &reclaimed);
+    ASSERT_EQ(1, participant.pending());
+
+    participant.collect();
+    ASSERT_EQ(0, reclaimed);
+
+    participant.collect();
+    ASSERT_EQ(1, reclaimed);
+    ASSERT_EQ(0, participant.pending());
+}
+
+TEST(Epoch, pinnedReaderHoldsBackReclamation) {
+    EpochManager manager;
+    EpochManager::Participant writer(manager);
+    EpochManager::Participant reader(manager);
+    int reclaimed = 0;
+    {
+        EpochManager::Guard guard = reader.pin();
+        EpochManager::Guard nested = reader.pin();
+        uint64_t pinned_epoch = manager.epoch();
+
+        writer.retire(new int(1), delete_and_count, &reclaimed);
+        for (int i = 0; i < 10; i++)
+        {
+            writer.collect();
+        }
+
+        ASSERT_EQ(0, reclaimed);
+        ASSERT_LE(manager.epoch(), pinned_epoch + 1);
+    }
+
+    writer.collect();
+    writer.collect();
+    ASSERT_EQ(1, reclaimed);
+}
+
+TEST(Epoch, limboOfLeavingParticipantIsReclaimedLater) {
+    int reclaimed = 0;
+    {
+        EpochManager manager;
+        EpochManager::Participant reader(manager);
+        EpochManager::Guard guard = reader.pin();
+        {
+            EpochManager::Participant writer(manager);
+            for (int i = 0; i < 3; i++)
+            {
+                writer.retire(new int(i), delete_and_count, &reclaimed);
+            }
+        }
+        ASSERT_EQ(0, reclaimed);
+    }
+
+    ASSERT_EQ(3, reclaimed);
+}
+
+TEST(Epoch, participantSlotsAreLimited) {
+    EpochManager manager;
+    std::vector<EpochManager::Participant> participants;
+    for (size_t i = 0; i < EpochManager::max_participants; i++)
+    {
+        participants.push_back(EpochManager::Participant(manager));
+    }
+
+    ASSERT_THROW(EpochManager::Participant extra(manager), too_many_participants_exception);
+
+    participants.pop_back();
+    EpochManager::Participant again(manager);
+}
+
+// Readers follow a pointer which the writer keeps replacing and retiring, a reclaimed object
+// read by a pinned reader would be a use after free.
+TEST(Epoch, readersNeverSeeReclaimedObjects) {
+    EpochManager manager;
+    std::atomic<int*> shared{new int(0)};
+    std::atomic<bool> writing{true};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++)
+    {
+        readers.emplace_back([&manager, &shared, &writing, &errors] {
+            EpochManager::Participant participant(manager);
+            int previous = 0;
+            while (writing.load())
+            {
+                EpochManager::Guard guard = participant.pin();
+                int value = *shared.load();
+                if (value < previous)
+                {
+                    errors++;
+                }
+                previous = value;
+            }
+        });
+    }
+
+    {
+        EpochManager::Participant participant(manager);
+        for (int i = 1; i <= 20000; i++)
+        {
+            int* old = shared.exchange(new int(i));
+            participant.retire(old);
+        }
+        writing.store(false);
+        for (std::thread & reader : readers)
+        {
+            reader.join();
+        }
+
+        participant.collect();
+        participant.collect();
+        ASSERT_EQ(0, participant.pending());
+    }
+
+    ASSERT_EQ(0, errors.load());
+    delete shared.load();
+}
+
+#endif
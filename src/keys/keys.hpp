@@ -3,9 +3,24 @@
 
 #include<vector>
 #include<iterator>
+#include<string>
 #include<algorithm>
+#include<cstdlib>
+#include<type_traits>
+#include<utility>
 #include<assert.h>
 
+#include "keys/search.hpp"
+
+
+// Built without exception support (-fno-exceptions) the errors which would be thrown abort the program,
+// find, try_get, try_emplace, insert_or_assign and upsert report their outcome without them.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+#define BTREE_THROW(exception) throw exception
+#else
+#define BTREE_THROW(exception) std::abort()
+#endif
+
 
 namespace btree
 {
@@ -17,7 +32,11 @@ namespace btree
 
         KeyValue() = default;
 
-        KeyValue(const KEY key, const VALUE value): key(key), value(value) {}
+        KeyValue(KEY key, VALUE value): key(std::move(key)), value(std::move(value)) {}
+
+        KeyValue(const std::pair<KEY, VALUE> & pair): key(pair.first), value(pair.second) {}
+
+        KeyValue(std::pair<KEY, VALUE> && pair): key(std::move(pair.first)), value(std::move(pair.second)) {}
 
         struct Compare
         {
@@ -59,6 +78,25 @@ namespace btree
     };
 
 
+    // An entry of a node seen in place, the value can be modified or moved out without copying the entry.
+    // With split_layout the key and the value are not next to each other, so there is no KeyValue to refer to.
+    // KEY_HOLDER is KEY where the storage builds the key when it is read (prefix_compressed_layout).
+    template<typename KEY, typename VALUE, typename KEY_HOLDER = const KEY &>
+    struct KeyValueRef
+    {
+        KEY_HOLDER key;
+        VALUE & value;
+
+        KeyValueRef(KEY_HOLDER key, VALUE & value): key(std::forward<KEY_HOLDER>(key)), value(value) {}
+
+        // a reference to a const value gives a pair which can be stored
+        operator std::pair<KEY, typename std::remove_const<VALUE>::type> () const
+        {
+            return std::pair<KEY, typename std::remove_const<VALUE>::type>(key, value);
+        }
+    };
+
+
     template<class Node>
     struct Branch
     {
@@ -68,8 +106,8 @@ namespace btree
         Node* left;
         Node* right;
 
-        Branch(KV kv): kv(kv), left(nullptr), right(nullptr) {}
-        Branch(KV kv, Node* left, Node* right): kv(kv), left(left), right(right) {}
+        Branch(KV kv): kv(std::move(kv)), left(nullptr), right(nullptr) {}
+        Branch(KV kv, Node* left, Node* right): kv(std::move(kv)), left(left), right(right) {}
 
         bool has_children() const noexcept
         {
@@ -88,244 +126,600 @@ namespace btree
     };
 
 
-    template <class Node>
-    class Keys
+    class duplicated_key_exception: public std::exception
+    {
+    public:
+        virtual const char* what() const noexcept override
+        {
+            return "duplicated key";
+        }
+    };
+
+
+    // Result of a lookup which may miss, like an optional reference to the value.
+    // Checking and dereferencing do not throw, only the conversion to VALUE & throws on a miss.
+    template<typename VALUE>
+    class SearchedValue
     {
     private:
-        using KV = KeyValue<typename Node::key_t, typename Node::value_t>;
+        VALUE * v = nullptr;
 
-        size_t degree;
-        Node* owner;
-        std::vector<KV> keyvalues;
-        std::vector<Node*> children;
+    public:
+        bool is_present = false;
+
+        SearchedValue() = default;
+        SearchedValue(bool _is_present, VALUE * _v): v(_v), is_present(_is_present) {}
 
-        Keys(size_t degree, Node* owner, std::vector<KV> _keyvalues): Keys(degree, owner)
+        explicit operator bool () const noexcept
         {
-            keyvalues = _keyvalues;
-            children.reserve(degree + 1);
+            return is_present;
         }
 
-        Keys(size_t degree, Node* owner, std::vector<KV> keyvalues, std::vector<Node*> new_children)
-            : Keys(degree, owner, keyvalues)
+        VALUE & operator*() const noexcept
         {
-            assert(keyvalues.size() + 1 == new_children.size());
+            return *v;
+        }
 
-            children = new_children;
+        VALUE * operator->() const noexcept
+        {
+            return v;
         }
 
-    public:
-        Keys() = default;
+        operator VALUE & () const
+        {
+            if (!is_present)
+            {
+                BTREE_THROW(key_does_not_exist_exception());
+            }
+
+            return *v;
+        }
+    };
+
+
+    // keys and values are stored side by side, a hit finds its value in the cache line of its key
+    struct interleaved_layout {};
 
-        Keys(size_t degree, Node* owner = nullptr): degree(degree), owner(owner)
+    // keys and values are stored in parallel arrays, a search only touches the keys
+    struct split_layout {};
+
+    // For std::string keys in BplusTree leaves: the prefix common to the keys of the node is stored once,
+    // the keys are stored without it. Reading a key builds it, the search compares the suffixes in place.
+    struct prefix_compressed_layout {};
+
+
+    template<typename KEY, typename VALUE, size_t CAPACITY, typename LAYOUT>
+    class NodeStorage;
+
+    template<typename KEY, typename VALUE, size_t CAPACITY>
+    class NodeStorage<KEY, VALUE, CAPACITY, interleaved_layout>
+    {
+    private:
+        using KV = KeyValue<KEY, VALUE>;
+
+        KV keyvalues[CAPACITY];
+
+    public:
+        const KEY & key(const size_t i) const noexcept
         {
-            keyvalues.reserve(degree);
-            children.reserve(degree + 1);
+            return keyvalues[i].key;
         }
 
-        template<typename VALUE>
-        class SearchedValue
+        bool is_key(const size_t i, const KEY & k) const
         {
-        private:
-            VALUE * v = nullptr;
+            return !(k < keyvalues[i].key) && !(keyvalues[i].key < k);
+        }
 
-        public:
-            bool is_present = false;
+        VALUE & value(const size_t i) noexcept
+        {
+            return keyvalues[i].value;
+        }
 
-            SearchedValue() = default;
-            SearchedValue(bool _is_present, VALUE * _v): v(_v), is_present(_is_present) {}
+        KV get(const size_t i) const
+        {
+            return keyvalues[i];
+        }
 
-            operator VALUE & ()
-            {
-                if (!is_present)
-                {
-                    throw key_does_not_exist_exception();
-                }
+        void insert(const size_t pos, const size_t size, KV && kv)
+        {
+            std::move_backward(keyvalues + pos, keyvalues + size, keyvalues + size + 1);
+            keyvalues[pos] = std::move(kv);
+        }
 
-                return *v;
-            }
-        };
+        void erase(const size_t pos, const size_t size)
+        {
+            std::move(keyvalues + pos + 1, keyvalues + size, keyvalues + pos);
+            keyvalues[size - 1] = KV();
+        }
 
-        SearchedValue<typename Node::value_t> find_and_get_value(typename Node::key_t k)
+        void reset(const size_t first, const size_t last)
         {
-            size_t pos =
-                std::lower_bound(keyvalues.begin(), keyvalues.end(), k, typename KV::Compare()) - keyvalues.begin();
-            if (pos >= keyvalues.size() || keyvalues[pos].key != k)
+            for (size_t i = first; i < last; i++)
             {
-                return SearchedValue<typename Node::value_t>();
+                keyvalues[i] = KV();
             }
+        }
 
-            return SearchedValue<typename Node::value_t>(true, &keyvalues[pos].value);
+        KV take(const size_t i)
+        {
+            KV kv = std::move(keyvalues[i]);
+            keyvalues[i] = KV();
+
+            return kv;
         }
 
-        Branch<Node> get_branch(const size_t i) const
+        void move(NodeStorage & from, const size_t first, const size_t last, const size_t dest)
         {
-            if (is_leaf())
+            std::move(from.keyvalues + first, from.keyvalues + last, keyvalues + dest);
+            from.reset(first, last);
+        }
+
+        size_t lower_bound(const size_t size, const KEY & k) const
+        {
+            return std::lower_bound(keyvalues, keyvalues + size, k, typename KV::Compare()) - keyvalues;
+        }
+
+        size_t upper_bound(const size_t size, const KEY & k) const
+        {
+            return std::upper_bound(keyvalues, keyvalues + size, k, typename KV::Compare()) - keyvalues;
+        }
+    };
+
+    template<typename KEY, typename VALUE, size_t CAPACITY>
+    class NodeStorage<KEY, VALUE, CAPACITY, split_layout>
+    {
+    private:
+        using KV = KeyValue<KEY, VALUE>;
+
+        KEY keys[CAPACITY];
+        VALUE values[CAPACITY];
+
+    public:
+        const KEY & key(const size_t i) const noexcept
+        {
+            return keys[i];
+        }
+
+        bool is_key(const size_t i, const KEY & k) const
+        {
+            return !(k < keys[i]) && !(keys[i] < k);
+        }
+
+        VALUE & value(const size_t i) noexcept
+        {
+            return values[i];
+        }
+
+        KV get(const size_t i) const
+        {
+            return KV(keys[i], values[i]);
+        }
+
+        void insert(const size_t pos, const size_t size, KV && kv)
+        {
+            std::move_backward(keys + pos, keys + size, keys + size + 1);
+            std::move_backward(values + pos, values + size, values + size + 1);
+            keys[pos] = std::move(kv.key);
+            values[pos] = std::move(kv.value);
+        }
+
+        void erase(const size_t pos, const size_t size)
+        {
+            std::move(keys + pos + 1, keys + size, keys + pos);
+            std::move(values + pos + 1, values + size, values + pos);
+            keys[size - 1] = KEY();
+            values[size - 1] = VALUE();
+        }
+
+        void reset(const size_t first, const size_t last)
+        {
+            for (size_t i = first; i < last; i++)
             {
-                return Branch<Node>(keyvalues[i]);
+                keys[i] = KEY();
+                values[i] = VALUE();
             }
+        }
+
+        KV take(const size_t i)
+        {
+            KV kv(std::move(keys[i]), std::move(values[i]));
+            keys[i] = KEY();
+            values[i] = VALUE();
 
-            return Branch<Node>(keyvalues[i], get_child(i), get_child(i + 1));
+            return kv;
         }
 
-        void add(const Branch<Node> b)
+        void move(NodeStorage & from, const size_t first, const size_t last, const size_t dest)
         {
-            auto pos = get_pos_of_key(b.kv);
-            keyvalues.insert(keyvalues.begin() + pos, b.kv);
+            std::move(from.keys + first, from.keys + last, keys + dest);
+            std::move(from.values + first, from.values + last, values + dest);
+            from.reset(first, last);
+        }
 
-            if (is_last_position(pos))
+        size_t lower_bound(const size_t size, const KEY & k) const
+        {
+            return lower_bound_of_key(keys, size, k);
+        }
+
+        size_t upper_bound(const size_t size, const KEY & k) const
+        {
+            return upper_bound_of_key(keys, size, k);
+        }
+    };
+
+
+    template<typename CHAR, typename TRAITS, typename ALLOCATOR, typename VALUE, size_t CAPACITY>
+    class NodeStorage<std::basic_string<CHAR, TRAITS, ALLOCATOR>, VALUE, CAPACITY, prefix_compressed_layout>
+    {
+    private:
+        using KEY = std::basic_string<CHAR, TRAITS, ALLOCATOR>;
+        using KV = KeyValue<KEY, VALUE>;
+
+        KEY prefix;
+        KEY suffixes[CAPACITY];
+        VALUE values[CAPACITY];
+
+    public:
+        KEY key(const size_t i) const
+        {
+            return prefix + suffixes[i];
+        }
+
+        bool is_key(const size_t i, const KEY & k) const noexcept
+        {
+            return k.size() == prefix.size() + suffixes[i].size() && compare_to_prefix(k) == 0 && compare(i, k) == 0;
+        }
+
+        VALUE & value(const size_t i) noexcept
+        {
+            return values[i];
+        }
+
+        KV get(const size_t i) const
+        {
+            return KV(key(i), values[i]);
+        }
+
+        const KEY & common_prefix() const noexcept
+        {
+            return prefix;
+        }
+
+        void insert(const size_t pos, const size_t size, KV && kv)
+        {
+            if (size == 0)
             {
-                push_children_of_branch(b);
+                prefix = std::move(kv.key);
+                kv.key = KEY();
             }
             else
             {
-                insert_children_of_branch_to_pos(b, pos);
+                shorten_prefix(size, common_length(prefix, kv.key));
+                kv.key.erase(0, prefix.size());
             }
+
+            std::move_backward(suffixes + pos, suffixes + size, suffixes + size + 1);
+            std::move_backward(values + pos, values + size, values + size + 1);
+            suffixes[pos] = std::move(kv.key);
+            values[pos] = std::move(kv.value);
         }
 
-        Node* select_child_for_key(const typename Node::key_t k) const
+        void erase(const size_t pos, const size_t size)
         {
-            return children[get_pos_of_key(k)];
+            std::move(suffixes + pos + 1, suffixes + size, suffixes + pos);
+            std::move(values + pos + 1, values + size, values + pos);
+            suffixes[size - 1] = KEY();
+            values[size - 1] = VALUE();
         }
 
-        bool is_present(const typename Node::key_t k) const noexcept
+        void reset(const size_t first, const size_t last)
         {
-            return std::binary_search(keyvalues.begin(), keyvalues.end(), k, typename KV::Compare());
+            for (size_t i = first; i < last; i++)
+            {
+                suffixes[i] = KEY();
+                values[i] = VALUE();
+            }
         }
 
-        KV get_median_KV_with_new_key(const KV k) const
+        KV take(const size_t i)
         {
-            std::vector<KV> tmp(keyvalues.begin(), keyvalues.end());
-            tmp.insert(tmp.begin() + get_pos_of_key(k), k);
-            size_t middle = keyvalues.size() / 2;
+            KV kv(key(i), std::move(values[i]));
+            suffixes[i] = KEY();
+            values[i] = VALUE();
 
-            return tmp[middle];
+            return kv;
         }
 
-        Branch<Node> get_first_branch() const noexcept
+        // [first, last) is the tail of from, dest is the size of this storage, the prefixes of both
+        // storages are adjusted to the keys they hold afterwards
+        void move(NodeStorage & from, const size_t first, const size_t last, const size_t dest)
         {
-            if (is_leaf())
+            if (dest == 0)
             {
-                return Branch<Node>(keyvalues[0]);
+                prefix = from.prefix;
+            }
+            else
+            {
+                shorten_prefix(dest, common_length(prefix, from.prefix));
             }
 
-            return Branch<Node>(keyvalues[0], get_child(0), get_child(1));
+            KEY cut = from.prefix.substr(prefix.size());
+            for (size_t i = first; i < last; i++)
+            {
+                suffixes[dest + i - first] = cut + from.suffixes[i];
+                values[dest + i - first] = std::move(from.values[i]);
+            }
+            from.reset(first, last);
+
+            lengthen_prefix(dest + last - first);
+            from.lengthen_prefix(first);
         }
 
-        Branch<Node> get_last_branch() const noexcept
+        size_t lower_bound(const size_t size, const KEY & k) const noexcept
         {
-            auto last_index = keyvalues.size() - 1;
+            int prefix_order = compare_to_prefix(k);
+            if (prefix_order != 0)
+            {
+                return prefix_order < 0 ? 0 : size;
+            }
 
-            if (is_leaf())
+            size_t low = 0;
+            size_t high = size;
+            while (low < high)
             {
-                return Branch<Node>(keyvalues[last_index]);
+                size_t middle = low + (high - low) / 2;
+                if (compare(middle, k) < 0)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
             }
 
-            return Branch<Node>(keyvalues[last_index], get_child(last_index), get_child(last_index + 1));
+            return low;
         }
 
-        size_t size() const noexcept
+        size_t upper_bound(const size_t size, const KEY & k) const noexcept
         {
-            return keyvalues.size();
+            int prefix_order = compare_to_prefix(k);
+            if (prefix_order != 0)
+            {
+                return prefix_order < 0 ? 0 : size;
+            }
+
+            size_t low = 0;
+            size_t high = size;
+            while (low < high)
+            {
+                size_t middle = low + (high - low) / 2;
+                if (compare(middle, k) <= 0)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+
+            return low;
         }
 
-        std::vector<KV> dump() const
+    private:
+        static size_t common_length(const KEY & a, const KEY & b) noexcept
         {
-            return keyvalues;
+            size_t length = 0;
+            while (length < a.size() && length < b.size() && TRAITS::eq(a[length], b[length]))
+            {
+                length++;
+            }
+
+            return length;
         }
 
-        void clear() noexcept
+        // <0 if k is less than every key with the prefix, >0 if it is greater, 0 if k starts with the prefix
+        int compare_to_prefix(const KEY & k) const noexcept
         {
-            keyvalues.clear();
-            children.clear();
+            size_t length = std::min(k.size(), prefix.size());
+            int order = TRAITS::compare(k.data(), prefix.data(), length);
+            if (order != 0)
+            {
+                return order;
+            }
+
+            return k.size() < prefix.size() ? -1 : 0;
         }
 
-        bool is_leaf() const noexcept
+        // the order of key i and k, which starts with the prefix
+        int compare(const size_t i, const KEY & k) const noexcept
         {
-            return children.size() == 0;
+            const KEY & suffix = suffixes[i];
+            const CHAR* rest = k.data() + prefix.size();
+            size_t rest_size = k.size() - prefix.size();
+
+            int order = TRAITS::compare(suffix.data(), rest, std::min(suffix.size(), rest_size));
+            if (order != 0)
+            {
+                return order;
+            }
+
+            return suffix.size() < rest_size ? -1 : (suffix.size() > rest_size ? 1 : 0);
         }
 
-        typename std::vector<Node*>::iterator children_begin() noexcept
+        void shorten_prefix(const size_t size, const size_t length)
         {
-            return children.begin();
+            if (length == prefix.size())
+            {
+                return;
+            }
+
+            KEY cut = prefix.substr(length);
+            for (size_t i = 0; i < size; i++)
+            {
+                suffixes[i].insert(0, cut);
+            }
+            prefix.erase(length);
         }
 
-        typename std::vector<Node*>::iterator children_end() noexcept
+        // the keys are sorted, the prefix of the first and the last is common to all of them
+        void lengthen_prefix(const size_t size)
         {
-            return children.end();
+            if (size == 0)
+            {
+                return;
+            }
+
+            size_t length = common_length(suffixes[0], suffixes[size - 1]);
+            if (length == 0)
+            {
+                return;
+            }
+
+            prefix.append(suffixes[0], 0, length);
+            for (size_t i = 0; i < size; i++)
+            {
+                suffixes[i].erase(0, length);
+            }
         }
+    };
 
-        Node* get_rightmost_child() const
+    template<typename CHAR, typename TRAITS, typename ALLOCATOR, typename VALUE, size_t CAPACITY>
+    struct builds_keys<NodeStorage<std::basic_string<CHAR, TRAITS, ALLOCATOR>, VALUE, CAPACITY, prefix_compressed_layout>>
+        : std::true_type {};
+
+
+    template <class Node>
+    class Keys
+    {
+    private:
+        static_assert(!std::is_same<typename Node::layout_t, prefix_compressed_layout>::value,
+            "prefix_compressed_layout is a leaf layout of BplusTree, Btree keeps separators in the same nodes");
+
+        using KV = KeyValue<typename Node::key_t, typename Node::value_t>;
+        using search_t = typename Node::search_t;
+
+        // keyvalues and children are stored inline, so a node is one contiguous block
+        // and a lookup does not have to chase a pointer before it touches the keys.
+        // There is room for one key more than the degree, a full node takes the new key in place and then splits.
+        static const size_t max_keys = Node::degree + 1;
+        static const size_t max_children = Node::degree + 2;
+
+        Node* owner = nullptr;
+        size_t keys_size = 0;
+        size_t children_size = 0;
+        NodeStorage<typename Node::key_t, typename Node::value_t, max_keys, typename Node::layout_t> keyvalues;
+        Node* children[max_children];
+
+    public:
+        Keys() = default;
+
+        Keys(Node* owner): owner(owner) {}
+
+        SearchedValue<typename Node::value_t> find_and_get_value(const typename Node::key_t & k)
         {
-            return children[children.size() - 1];
+            size_t pos = search_t::lower_bound(keyvalues, keys_size, k);
+            if (pos >= keys_size || keyvalues.key(pos) != k)
+            {
+                return SearchedValue<typename Node::value_t>();
+            }
+
+            return SearchedValue<typename Node::value_t>(true, &keyvalues.value(pos));
         }
 
-        void set_owner(Node* new_owner) noexcept
+        const typename Node::key_t & key(const size_t i) const noexcept
         {
-            owner = new_owner;
+            return keyvalues.key(i);
+        }
 
-            for (Node* child : children)
-            {
-                child->parent = owner;
-            }
+        typename Node::value_t & value(const size_t i) noexcept
+        {
+            return keyvalues.value(i);
         }
 
-        Keys<Node> get_left_half_of_keys() const
+        KeyValueRef<typename Node::key_t, typename Node::value_t> entry(const size_t i) noexcept
         {
-            size_t half = keyvalues.size() / 2;
-            auto left_keyvalues = std::vector<KV>(keyvalues.begin(), keyvalues.begin() + half);
+            return KeyValueRef<typename Node::key_t, typename Node::value_t>(keyvalues.key(i), keyvalues.value(i));
+        }
 
+        Branch<Node> get_branch(const size_t i) const
+        {
             if (is_leaf())
             {
-                return Keys<Node>(degree, owner, left_keyvalues);
+                return Branch<Node>(keyvalues.get(i));
             }
 
-            auto left_children = std::vector<Node*>(children.begin(), children.begin() + half + 1);
+            return Branch<Node>(keyvalues.get(i), get_child(i), get_child(i + 1));
+        }
 
-            return Keys<Node>(degree, owner, left_keyvalues, left_children);
+        void add(Branch<Node> b)
+        {
+            size_t pos = upper_bound(b.kv.key);
+            insert(pos, std::move(b));
         }
 
-        Keys<Node> get_right_half_of_keys() const
+        // inserts the branch to a position which was found by an earlier search, its entry is moved into the node
+        void insert(const size_t pos, Branch<Node> b)
         {
-            size_t half = keyvalues.size() / 2;
-            auto right_keyvalues = std::vector<KV>(keyvalues.begin() + half, keyvalues.end());
+            assert(keys_size < max_keys);
 
-            if (is_leaf())
+            keyvalues.insert(pos, keys_size, std::move(b.kv));
+            keys_size++;
+
+            if (is_last_position(pos))
+            {
+                push_children_of_branch(b);
+            }
+            else
             {
-                return Keys<Node>(degree, owner, right_keyvalues);
+                insert_children_of_branch_to_pos(b, pos);
             }
+        }
 
-            auto right_children = std::vector<Node*>(children.begin() + half, children.end());
+        // appends to the end of the node without searching, for building nodes from sorted keys
+        void append(KV kv)
+        {
+            assert(keys_size < max_keys);
 
-            return Keys<Node>(degree, owner, right_keyvalues, right_children);
+            keyvalues.insert(keys_size, keys_size, std::move(kv));
+            keys_size++;
         }
 
-        void change_first_to(const Branch<Node> new_first)
+        void append_child(Node* child)
         {
-            remove_first();
-            add(new_first);
+            assert(children_size < max_children);
+
+            child->parent = owner;
+            children[children_size++] = child;
         }
 
-        void change_last_to(const Branch<Node> new_last)
+        bool is_present(const typename Node::key_t & k) const noexcept
         {
-            remove_last();
-            add(new_last);
+            return is_key_at(lower_bound(k), k);
         }
 
+        // Position of the first key which is not less than k. One search tells both whether k is present
+        // (is_key_at) and, if it is not, which child leads to it and where it has to be inserted.
+        size_t lower_bound(const typename Node::key_t & k) const
+        {
+            return search_t::lower_bound(keyvalues, keys_size, k);
+        }
 
-    private:
-        bool is_last_position(const size_t i) const noexcept
+        // position of the first key which is greater than k
+        size_t upper_bound(const typename Node::key_t & k) const
         {
-            return i + 1 >= keyvalues.size();
+            return search_t::upper_bound(keyvalues, keys_size, k);
         }
 
-        size_t get_pos_of_key(const typename Node::key_t  k) const
+        bool is_key_at(const size_t pos, const typename Node::key_t & k) const noexcept
         {
-            return std::upper_bound(keyvalues.begin(), keyvalues.end(), k, typename KV::Compare()) - keyvalues.begin();
+            return pos < keys_size && !(k < keyvalues.key(pos));
         }
 
         Node* get_child(const size_t i) const noexcept
         {
-            if (children.size() < i + 1)
+            if (children_size < i + 1)
             {
                 return nullptr;
             }
@@ -333,34 +727,88 @@ namespace btree
             return children[i];
         }
 
-        void push_children_of_branch(Branch<Node> b)
+        size_t size() const noexcept
         {
-            if (!b.has_children())
+            return keys_size;
+        }
+
+        std::vector<KV> dump() const
+        {
+            std::vector<KV> result;
+            for (size_t i = 0; i < keys_size; i++)
             {
-                return;
+                result.push_back(keyvalues.get(i));
             }
 
-            own_branch(b);
+            return result;
+        }
 
-            if (children.size() == 0)
-            {
-                children.push_back(b.left);
-            }
-            else
+        void clear() noexcept
+        {
+            keyvalues.reset(0, keys_size);
+            keys_size = 0;
+            children_size = 0;
+        }
+
+        bool is_leaf() const noexcept
+        {
+            return children_size == 0;
+        }
+
+        Node** children_begin() noexcept
+        {
+            return children;
+        }
+
+        Node** children_end() noexcept
+        {
+            return children + children_size;
+        }
+
+        Node* get_rightmost_child() const
+        {
+            return children[children_size - 1];
+        }
+
+        void set_owner(Node* new_owner) noexcept
+        {
+            owner = new_owner;
+
+            for (size_t i = 0; i < children_size; i++)
             {
-                children[children.size() - 1] = b.left;
+                children[i]->parent = owner;
             }
+        }
+
+        // Splits an overflowing node: the keys right of the median and the children between them move to
+        // the empty right node, the median is removed and returned, the rest stays in this node.
+        KV split(Keys & right)
+        {
+            assert(right.size() == 0 && right.is_leaf());
+
+            size_t median = (keys_size - 1) / 2;
+            move_to(right, median + 1);
+
+            KV median_kv = keyvalues.take(median);
+            keys_size--;
 
-            children.push_back(b.right);
+            return median_kv;
         }
 
-        void own_branch(Branch<Node> b)
+        // moves all keys and children to the end of other
+        void move_to(Keys & other)
         {
-            b.left->parent = owner;
-            b.right->parent = owner;
+            move_to(other, 0);
         }
 
-        void insert_children_of_branch_to_pos(Branch<Node> b, const size_t pos)
+
+    private:
+        bool is_last_position(const size_t i) const noexcept
+        {
+            return i + 1 >= keys_size;
+        }
+
+        void push_children_of_branch(const Branch<Node> & b)
         {
             if (!b.has_children())
             {
@@ -369,33 +817,62 @@ namespace btree
 
             own_branch(b);
 
-            children.insert(children.begin() + pos, b.left);
-            children[pos+1] = b.right;
+            if (children_size == 0)
+            {
+                children[children_size++] = b.left;
+            }
+            else
+            {
+                children[children_size - 1] = b.left;
+            }
+
+            children[children_size++] = b.right;
         }
 
-        void remove_first()
+        // moves the keys and the children from position first to the end of other,
+        // this node is left with one child less than keys until its last key is taken
+        void move_to(Keys & other, const size_t first)
         {
-            keyvalues.erase(keyvalues.begin());
+            size_t moved_keys = keys_size - first;
+            assert(other.keys_size + moved_keys <= max_keys);
+
+            other.keyvalues.move(keyvalues, first, keys_size, other.keys_size);
+            other.keys_size += moved_keys;
+            keys_size = first;
 
             if (is_leaf())
             {
                 return;
             }
 
-            children.erase(children.begin());
+            for (size_t i = first; i < children_size; i++)
+            {
+                other.append_child(children[i]);
+            }
+            children_size = first;
         }
 
-        void remove_last()
+        void own_branch(const Branch<Node> & b)
         {
-            keyvalues.erase(keyvalues.end() - 1);
+            b.left->parent = owner;
+            b.right->parent = owner;
+        }
 
-            if (is_leaf())
+        void insert_children_of_branch_to_pos(const Branch<Node> & b, const size_t pos)
+        {
+            if (!b.has_children())
             {
                 return;
             }
 
-            children.erase(children.end() - 1);
+            own_branch(b);
+
+            std::move_backward(children + pos, children + children_size, children + children_size + 1);
+            children_size++;
+            children[pos] = b.left;
+            children[pos+1] = b.right;
         }
+
     };
 }
 
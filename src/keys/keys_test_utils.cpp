@@ -33,7 +33,7 @@ namespace btree
 
     Keys<TestNode<>> KeysFactoryRAII::create_keys(size_t n)
     {
-        Keys<TestNode<>> ks(n+1);
+        Keys<TestNode<>> ks;
         auto nodes = node_factory.create_nodes(n + 1);
 
         for (size_t i = 0; i < n; i++)
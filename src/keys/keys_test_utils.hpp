@@ -14,11 +14,15 @@ namespace btree
     KeyValue<int, const char*> get_kv(size_t n);
 
 
-    template<typename K = int, typename V = const char*>
+    template<typename K = int, typename V = const char*, size_t DEGREE = 10,
+             typename LAYOUT = interleaved_layout, typename SEARCH = default_search>
     struct TestNode
     {
+        static const size_t degree = DEGREE;
         using key_t = K;
         using value_t = V;
+        using layout_t = LAYOUT;
+        using search_t = SEARCH;
 
         KeyValue<key_t, value_t> kv;
         TestNode* parent;
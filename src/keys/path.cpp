@@ -0,0 +1 @@
+#include "path.hpp"
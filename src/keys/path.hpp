@@ -0,0 +1,28 @@
+#ifndef PATH_H_
+#define PATH_H_
+
+#include<cstddef>
+
+
+namespace btree
+{
+    // Bound of the height of the trees: every level has at least two times fewer nodes than the one below
+    // it, so a tree of more levels would not fit into memory.
+    const size_t max_height = 64;
+
+    // the nodes visited from the root down to the one a change starts at, and the position taken in each
+    template<typename NODE>
+    struct NodePath
+    {
+        struct Step
+        {
+            NODE* node;
+            size_t pos;
+        };
+
+        Step steps[max_height];
+        size_t length = 0;
+    };
+}
+
+#endif
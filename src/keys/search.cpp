@@ -0,0 +1 @@
+#include "search.hpp"
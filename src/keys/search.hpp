@@ -0,0 +1,579 @@
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+#include<algorithm>
+#include<cstdint>
+#include<cstddef>
+#include<type_traits>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include<immintrin.h>
+#endif
+
+
+namespace btree
+{
+    // Counting search: the position of a key in a sorted node equals the number of keys which are smaller
+    // (lower bound) or not greater (upper bound) than it. Counting compares every key, but it has no
+    // data dependent branches and it can be done with wide compares, which beats binary search on the
+    // small arrays of a node.
+
+    template<typename KEY>
+    size_t count_less(const KEY* keys, const size_t size, const KEY k) noexcept
+    {
+        size_t result = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            result += keys[i] < k;
+        }
+
+        return result;
+    }
+
+    template<typename KEY>
+    size_t count_less_or_equal(const KEY* keys, const size_t size, const KEY k) noexcept
+    {
+        size_t result = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            result += !(k < keys[i]);
+        }
+
+        return result;
+    }
+
+#if defined(__AVX2__)
+    inline size_t count_less(const int64_t* keys, const size_t size, const int64_t k) noexcept
+    {
+        const __m256i needle = _mm256_set1_epi64x(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m256i ks = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            __m256i less = _mm256_cmpgt_epi64(needle, ks);
+            result += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(less)));
+        }
+
+        return result + count_less<int64_t>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less_or_equal(const int64_t* keys, const size_t size, const int64_t k) noexcept
+    {
+        const __m256i needle = _mm256_set1_epi64x(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m256i ks = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            __m256i greater = _mm256_cmpgt_epi64(ks, needle);
+            result += 4 - __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(greater)));
+        }
+
+        return result + count_less_or_equal<int64_t>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less(const int32_t* keys, const size_t size, const int32_t k) noexcept
+    {
+        const __m256i needle = _mm256_set1_epi32(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            __m256i ks = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            __m256i less = _mm256_cmpgt_epi32(needle, ks);
+            result += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(less)));
+        }
+
+        return result + count_less<int32_t>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less_or_equal(const int32_t* keys, const size_t size, const int32_t k) noexcept
+    {
+        const __m256i needle = _mm256_set1_epi32(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            __m256i ks = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            __m256i greater = _mm256_cmpgt_epi32(ks, needle);
+            result += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(greater)));
+        }
+
+        return result + count_less_or_equal<int32_t>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less(const double* keys, const size_t size, const double k) noexcept
+    {
+        const __m256d needle = _mm256_set1_pd(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m256d less = _mm256_cmp_pd(_mm256_loadu_pd(keys + i), needle, _CMP_LT_OQ);
+            result += __builtin_popcount(_mm256_movemask_pd(less));
+        }
+
+        return result + count_less<double>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less_or_equal(const double* keys, const size_t size, const double k) noexcept
+    {
+        const __m256d needle = _mm256_set1_pd(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m256d not_greater = _mm256_cmp_pd(_mm256_loadu_pd(keys + i), needle, _CMP_LE_OQ);
+            result += __builtin_popcount(_mm256_movemask_pd(not_greater));
+        }
+
+        return result + count_less_or_equal<double>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less(const float* keys, const size_t size, const float k) noexcept
+    {
+        const __m256 needle = _mm256_set1_ps(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            __m256 less = _mm256_cmp_ps(_mm256_loadu_ps(keys + i), needle, _CMP_LT_OQ);
+            result += __builtin_popcount(_mm256_movemask_ps(less));
+        }
+
+        return result + count_less<float>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less_or_equal(const float* keys, const size_t size, const float k) noexcept
+    {
+        const __m256 needle = _mm256_set1_ps(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            __m256 not_greater = _mm256_cmp_ps(_mm256_loadu_ps(keys + i), needle, _CMP_LE_OQ);
+            result += __builtin_popcount(_mm256_movemask_ps(not_greater));
+        }
+
+        return result + count_less_or_equal<float>(keys + i, size - i, k);
+    }
+#elif defined(__SSE4_2__)
+    inline size_t count_less(const int64_t* keys, const size_t size, const int64_t k) noexcept
+    {
+        const __m128i needle = _mm_set1_epi64x(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 2 <= size; i += 2)
+        {
+            __m128i ks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            __m128i less = _mm_cmpgt_epi64(needle, ks);
+            result += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(less)));
+        }
+
+        return result + count_less<int64_t>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less_or_equal(const int64_t* keys, const size_t size, const int64_t k) noexcept
+    {
+        const __m128i needle = _mm_set1_epi64x(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 2 <= size; i += 2)
+        {
+            __m128i ks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            __m128i greater = _mm_cmpgt_epi64(ks, needle);
+            result += 2 - __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(greater)));
+        }
+
+        return result + count_less_or_equal<int64_t>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less(const int32_t* keys, const size_t size, const int32_t k) noexcept
+    {
+        const __m128i needle = _mm_set1_epi32(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m128i ks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            __m128i less = _mm_cmpgt_epi32(needle, ks);
+            result += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(less)));
+        }
+
+        return result + count_less<int32_t>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less_or_equal(const int32_t* keys, const size_t size, const int32_t k) noexcept
+    {
+        const __m128i needle = _mm_set1_epi32(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            __m128i ks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            __m128i greater = _mm_cmpgt_epi32(ks, needle);
+            result += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(greater)));
+        }
+
+        return result + count_less_or_equal<int32_t>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less(const double* keys, const size_t size, const double k) noexcept
+    {
+        const __m128d needle = _mm_set1_pd(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 2 <= size; i += 2)
+        {
+            result += __builtin_popcount(_mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(keys + i), needle)));
+        }
+
+        return result + count_less<double>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less_or_equal(const double* keys, const size_t size, const double k) noexcept
+    {
+        const __m128d needle = _mm_set1_pd(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 2 <= size; i += 2)
+        {
+            result += __builtin_popcount(_mm_movemask_pd(_mm_cmple_pd(_mm_loadu_pd(keys + i), needle)));
+        }
+
+        return result + count_less_or_equal<double>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less(const float* keys, const size_t size, const float k) noexcept
+    {
+        const __m128 needle = _mm_set1_ps(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            result += __builtin_popcount(_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(keys + i), needle)));
+        }
+
+        return result + count_less<float>(keys + i, size - i, k);
+    }
+
+    inline size_t count_less_or_equal(const float* keys, const size_t size, const float k) noexcept
+    {
+        const __m128 needle = _mm_set1_ps(k);
+        size_t result = 0;
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4)
+        {
+            result += __builtin_popcount(_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(keys + i), needle)));
+        }
+
+        return result + count_less_or_equal<float>(keys + i, size - i, k);
+    }
+#endif
+
+
+    // Arithmetic keys are located by counting, everything else by binary search.
+
+    template<typename KEY>
+    size_t lower_bound_of_key(const KEY* keys, const size_t size, const KEY & k, std::true_type) noexcept
+    {
+        return count_less(keys, size, k);
+    }
+
+    template<typename KEY>
+    size_t lower_bound_of_key(const KEY* keys, const size_t size, const KEY & k, std::false_type)
+    {
+        return std::lower_bound(keys, keys + size, k) - keys;
+    }
+
+    template<typename KEY>
+    size_t lower_bound_of_key(const KEY* keys, const size_t size, const KEY & k)
+    {
+        return lower_bound_of_key(keys, size, k, std::is_arithmetic<KEY>());
+    }
+
+    template<typename KEY>
+    size_t upper_bound_of_key(const KEY* keys, const size_t size, const KEY & k, std::true_type) noexcept
+    {
+        return count_less_or_equal(keys, size, k);
+    }
+
+    template<typename KEY>
+    size_t upper_bound_of_key(const KEY* keys, const size_t size, const KEY & k, std::false_type)
+    {
+        return std::upper_bound(keys, keys + size, k) - keys;
+    }
+
+    template<typename KEY>
+    size_t upper_bound_of_key(const KEY* keys, const size_t size, const KEY & k)
+    {
+        return upper_bound_of_key(keys, size, k, std::is_arithmetic<KEY>());
+    }
+
+
+    // Search policies, they select how a key is located within a node. A policy works on the keys of a
+    // node through key(i), so it is independent from the layout of the node.
+
+    // A storage which builds a key every time key(i) reads it (prefix_compressed_layout) specializes this
+    // trait, the policies leave such a storage to its own search, which compares the keys in place.
+    template<class KEYS>
+    struct builds_keys : std::false_type {};
+
+    // Uses the search of the node layout: counting for arithmetic keys of split_layout,
+    // binary search for everything else.
+    struct default_search
+    {
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            return keys.lower_bound(size, k);
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            return keys.upper_bound(size, k);
+        }
+    };
+
+    // Compares every key without branching, the fastest for small degrees.
+    struct linear_search
+    {
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            return lower_bound(keys, size, k, builds_keys<KEYS>());
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            return upper_bound(keys, size, k, builds_keys<KEYS>());
+        }
+
+    private:
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k, std::false_type)
+        {
+            size_t result = 0;
+            for (size_t i = 0; i < size; i++)
+            {
+                result += keys.key(i) < k;
+            }
+
+            return result;
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k, std::false_type)
+        {
+            size_t result = 0;
+            for (size_t i = 0; i < size; i++)
+            {
+                result += !(k < keys.key(i));
+            }
+
+            return result;
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k, std::true_type)
+        {
+            return keys.lower_bound(size, k);
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k, std::true_type)
+        {
+            return keys.upper_bound(size, k);
+        }
+    };
+
+    // Binary search which halves the range with conditional moves instead of branches,
+    // so it does not suffer from mispredictions on medium degrees.
+    struct branchless_binary_search
+    {
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            return lower_bound(keys, size, k, builds_keys<KEYS>());
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            return upper_bound(keys, size, k, builds_keys<KEYS>());
+        }
+
+    private:
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k, std::false_type)
+        {
+            if (size == 0)
+            {
+                return 0;
+            }
+
+            size_t base = 0;
+            size_t n = size;
+            while (n > 1)
+            {
+                size_t half = n / 2;
+                base = (keys.key(base + half) < k) ? base + half : base;
+                n -= half;
+            }
+
+            return base + (keys.key(base) < k);
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k, std::false_type)
+        {
+            if (size == 0)
+            {
+                return 0;
+            }
+
+            size_t base = 0;
+            size_t n = size;
+            while (n > 1)
+            {
+                size_t half = n / 2;
+                base = (k < keys.key(base + half)) ? base : base + half;
+                n -= half;
+            }
+
+            return base + !(k < keys.key(base));
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k, std::true_type)
+        {
+            return keys.lower_bound(size, k);
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k, std::true_type)
+        {
+            return keys.upper_bound(size, k);
+        }
+    };
+
+    // Guesses the position of the key from its value, for uniformly distributed arithmetic keys it needs
+    // only a few probes even on large degrees. Other keys are searched with branchless_binary_search,
+    // which leaves a storage that builds its keys to its own search.
+    struct interpolation_search
+    {
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            return lower_bound(keys, size, k, std::is_arithmetic<KEY>());
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            return upper_bound(keys, size, k, std::is_arithmetic<KEY>());
+        }
+
+    private:
+        // ranges shorter than this are not worth the division of a guess
+        static const size_t linear_threshold = 8;
+
+        template<class KEYS, typename KEY>
+        static size_t guess(const KEYS & keys, const size_t low, const size_t high, const KEY & k)
+        {
+            double first = static_cast<double>(keys.key(low));
+            double last = static_cast<double>(keys.key(high - 1));
+            double ratio = (static_cast<double>(k) - first) / (last - first);
+            size_t pos = low + static_cast<size_t>(ratio * (high - 1 - low));
+
+            return std::min(std::max(pos, low), high - 1);
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k, std::true_type)
+        {
+            size_t low = 0;
+            size_t high = size;
+            while (high - low > linear_threshold)
+            {
+                if (!(keys.key(low) < k))
+                {
+                    return low;
+                }
+                if (keys.key(high - 1) < k)
+                {
+                    return high;
+                }
+
+                size_t pos = guess(keys, low, high, k);
+                if (keys.key(pos) < k)
+                {
+                    low = pos + 1;
+                }
+                else
+                {
+                    high = pos;
+                }
+            }
+
+            while (low < high && keys.key(low) < k)
+            {
+                low++;
+            }
+
+            return low;
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k, std::true_type)
+        {
+            size_t low = 0;
+            size_t high = size;
+            while (high - low > linear_threshold)
+            {
+                if (k < keys.key(low))
+                {
+                    return low;
+                }
+                if (!(k < keys.key(high - 1)))
+                {
+                    return high;
+                }
+
+                size_t pos = guess(keys, low, high, k);
+                if (k < keys.key(pos))
+                {
+                    high = pos;
+                }
+                else
+                {
+                    low = pos + 1;
+                }
+            }
+
+            while (low < high && !(k < keys.key(low)))
+            {
+                low++;
+            }
+
+            return low;
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k, std::false_type)
+        {
+            return branchless_binary_search::lower_bound(keys, size, k);
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k, std::false_type)
+        {
+            return branchless_binary_search::upper_bound(keys, size, k);
+        }
+    };
+}
+
+#endif
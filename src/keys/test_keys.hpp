@@ -2,6 +2,8 @@
 #define TEST_KEYS_H_
 
 #include <string>
+#include <vector>
+#include <algorithm>
 
 #include "gtest/gtest.h"
 
@@ -67,7 +69,7 @@ TEST(Keys, addNewBranchAtEnd) {
 }
 
 TEST(Keys, addNewBranchAtMiddle) {
-    Keys<TestNode<>> ks(9);
+    Keys<TestNode<>> ks;
     auto test_node_factory = TestNodeFactoryRAII();
     auto common_node = test_node_factory.create(100);
     ks.add(Branch<TestNode<>>(get_kv(1), test_node_factory.create(1), common_node));
@@ -91,7 +93,7 @@ TEST(Keys, addNewBranchAtMiddle) {
 }
 
 TEST(Keys, isPresent) {
-    Keys<TestNode<>> ks(4);
+    Keys<TestNode<>> ks;
 
     ks.add(get_kv(3));
     ks.add(get_kv(5));
@@ -105,158 +107,125 @@ TEST(Keys, isPresent) {
     ASSERT_TRUE(ks.is_present(5));
 }
 
-TEST(Keys, emptyGetMedianWithNewKey) {
-    Keys<TestNode<>> ks(4);
+TEST(Keys, splitLeafWithOddNumberOfKeys) {
+    Keys<TestNode<>> ks;
+    Keys<TestNode<>> right;
+    for (int i = 1; i <= 5; i++)
+    {
+        ks.add(get_kv(i));
+    }
 
-    ASSERT_EQ(1, ks.get_median_KV_with_new_key(get_kv(1)));
-}
-
-TEST(Keys, oneElementGetMedianWithNewKey) {
-    Keys<TestNode<>> ks(4);
-
-    ks.add(get_kv(4));
-
-    ASSERT_EQ(1, ks.get_median_KV_with_new_key(get_kv(1)));
-}
-
-TEST(Keys, twoElementsGetMedianWithNewKey) {
-    Keys<TestNode<>> ks(4);
-
-    ks.add(get_kv(2));
-    ks.add(get_kv(3));
-
-    ASSERT_EQ(2, ks.get_median_KV_with_new_key(get_kv(1)));
-}
-
-TEST(Keys, threeElementsGetMedianWithNewKey) {
-    Keys<TestNode<>> ks(4);
-
-    ks.add(get_kv(2));
-    ks.add(get_kv(3));
-    ks.add(get_kv(4));
-
-    ASSERT_EQ(2, ks.get_median_KV_with_new_key(get_kv(1)));
-}
-
-TEST(Keys, evenGetLeftHalfOfKeys) {
-    auto keys_factory = KeysFactoryRAII();
-    auto ks = keys_factory.create_keys(2);
-
-    auto half = ks.get_left_half_of_keys();
-
-    ASSERT_EQ(1, half.size());
-    ASSERT_EQ(1, half.get_branch(0).kv);
-    ASSERT_EQ(1, half.get_branch(0).left->kv);
-    ASSERT_EQ(2, half.get_branch(0).right->kv);
-}
-
-TEST(Keys, evenGetRightHalfOfKeys) {
-    auto keys_factory = KeysFactoryRAII();
-    auto ks = keys_factory.create_keys(2);
-
-    auto half = ks.get_right_half_of_keys();
+    auto median = ks.split(right);
 
-    ASSERT_EQ(1, half.size());
-    ASSERT_EQ(2, half.get_branch(0).kv);
-    ASSERT_EQ(2, half.get_branch(0).left->kv);
-    ASSERT_EQ(3, half.get_branch(0).right->kv);
+    ASSERT_EQ(3, median);
+    ASSERT_EQ(2, ks.size());
+    ASSERT_EQ(1, ks.get_branch(0).kv);
+    ASSERT_EQ(2, ks.get_branch(1).kv);
+    ASSERT_EQ(2, right.size());
+    ASSERT_EQ(4, right.get_branch(0).kv);
+    ASSERT_EQ(5, right.get_branch(1).kv);
+    ASSERT_TRUE(right.is_leaf());
 }
 
-TEST(Keys, oddGetLeftHalfOfKeys) {
-    auto keys_factory = KeysFactoryRAII();
-    auto ks = keys_factory.create_keys(3);
+TEST(Keys, splitLeafWithEvenNumberOfKeys) {
+    Keys<TestNode<>> ks;
+    Keys<TestNode<>> right;
+    for (int i = 1; i <= 4; i++)
+    {
+        ks.add(get_kv(i));
+    }
 
-    auto half = ks.get_left_half_of_keys();
+    auto median = ks.split(right);
 
-    ASSERT_EQ(1, half.size());
-    ASSERT_EQ(1, half.get_branch(0).kv);
-    ASSERT_EQ(1, half.get_branch(0).left->kv);
-    ASSERT_EQ(2, half.get_branch(0).right->kv);
+    ASSERT_EQ(2, median);
+    ASSERT_EQ(1, ks.size());
+    ASSERT_EQ(1, ks.get_branch(0).kv);
+    ASSERT_EQ(2, right.size());
+    ASSERT_EQ(3, right.get_branch(0).kv);
+    ASSERT_EQ(4, right.get_branch(1).kv);
 }
 
-TEST(Keys, oddGetRightHalfOfKeys) {
+TEST(Keys, splitKeysWithChildren) {
     auto keys_factory = KeysFactoryRAII();
+    auto test_node_factory = TestNodeFactoryRAII();
     auto ks = keys_factory.create_keys(3);
+    Keys<TestNode<>> right(test_node_factory.create(100));
 
-    auto half = ks.get_right_half_of_keys();
+    auto median = ks.split(right);
 
-    ASSERT_EQ(2, half.size());
-    ASSERT_EQ(2, half.get_branch(0).kv);
-    ASSERT_EQ(2, half.get_branch(0).left->kv);
-    ASSERT_EQ(3, half.get_branch(0).right->kv);
-    ASSERT_EQ(3, half.get_branch(1).kv);
-    ASSERT_EQ(3, half.get_branch(1).left->kv);
-    ASSERT_EQ(4, half.get_branch(1).right->kv);
+    ASSERT_EQ(2, median);
+    ASSERT_EQ(1, ks.size());
+    ASSERT_EQ(1, ks.get_branch(0).kv);
+    ASSERT_EQ(1, ks.get_branch(0).left->kv);
+    ASSERT_EQ(2, ks.get_branch(0).right->kv);
+    ASSERT_EQ(1, right.size());
+    ASSERT_EQ(3, right.get_branch(0).kv);
+    ASSERT_EQ(3, right.get_branch(0).left->kv);
+    ASSERT_EQ(4, right.get_branch(0).right->kv);
+    ASSERT_EQ(100, right.get_branch(0).left->parent->kv);
+    ASSERT_EQ(100, right.get_branch(0).right->parent->kv);
 }
 
-TEST(Keys, changeFirstToForKeysWithOneElement) {
-    auto keys_factory = KeysFactoryRAII();
-    auto test_node_factory = TestNodeFactoryRAII();
-    auto ks = keys_factory.create_keys(1);
+TEST(Keys, splitAfterAddingToFullKeys) {
+    Keys<TestNode<int, const char*, 2>> ks;
+    Keys<TestNode<int, const char*, 2>> right;
+    ks.add(get_kv(1));
+    ks.add(get_kv(3));
 
-    ks.change_first_to(
-        Branch<TestNode<>>(get_kv(9), test_node_factory.create(9), test_node_factory.create(10))
-    );
+    ks.add(get_kv(2));
+    auto median = ks.split(right);
 
-    ASSERT_EQ(1, ks.size());
-    ASSERT_EQ(9, ks.get_branch(0).kv);
-    ASSERT_EQ(9, ks.get_branch(0).left->kv);
-    ASSERT_EQ(10, ks.get_branch(0).right->kv);
+    ASSERT_EQ(2, median);
+    ASSERT_EQ(1, ks.get_branch(0).kv);
+    ASSERT_EQ(3, right.get_branch(0).kv);
 }
 
-TEST(Keys, changeFirstToForKeysWithMultipleElements) {
+TEST(Keys, moveTo) {
     auto keys_factory = KeysFactoryRAII();
     auto test_node_factory = TestNodeFactoryRAII();
     auto ks = keys_factory.create_keys(2);
-
-    ks.change_first_to(
-        Branch<TestNode<>>(get_kv(9), test_node_factory.create(9), test_node_factory.create(10))
-    );
-
-    ASSERT_EQ(2, ks.size());
-    ASSERT_EQ(2, ks.get_branch(0).kv);
-    ASSERT_EQ(2, ks.get_branch(0).left->kv);
-    ASSERT_EQ(9, ks.get_branch(0).right->kv);
-    ASSERT_EQ(9, ks.get_branch(1).kv);
-    ASSERT_EQ(9, ks.get_branch(1).left->kv);
-    ASSERT_EQ(10, ks.get_branch(1).right->kv);
+    Keys<TestNode<>> other(test_node_factory.create(100));
+
+    ks.move_to(other);
+
+    ASSERT_EQ(0, ks.size());
+    ASSERT_TRUE(ks.is_leaf());
+    ASSERT_EQ(2, other.size());
+    ASSERT_EQ(1, other.get_branch(0).kv);
+    ASSERT_EQ(1, other.get_branch(0).left->kv);
+    ASSERT_EQ(2, other.get_branch(1).kv);
+    ASSERT_EQ(3, other.get_branch(1).right->kv);
+    ASSERT_EQ(100, other.get_branch(1).right->parent->kv);
 }
 
-TEST(Keys, changeLastToForKeysWithOneElement) {
-    auto keys_factory = KeysFactoryRAII();
-    auto test_node_factory = TestNodeFactoryRAII();
-    auto ks = keys_factory.create_keys(1);
-
-    ks.change_last_to(
-        Branch<TestNode<>>(get_kv(9), test_node_factory.create(9), test_node_factory.create(10))
-    );
+TEST(Keys, lowerBoundTellsIfKeyIsPresent) {
+    Keys<TestNode<>> ks;
+    ks.add(get_kv(2));
+    ks.add(get_kv(4));
 
-    ASSERT_EQ(1, ks.size());
-    ASSERT_EQ(9, ks.get_branch(0).kv);
-    ASSERT_EQ(9, ks.get_branch(0).left->kv);
-    ASSERT_EQ(10, ks.get_branch(0).right->kv);
+    ASSERT_EQ(0, ks.lower_bound(1));
+    ASSERT_FALSE(ks.is_key_at(0, 1));
+    ASSERT_EQ(1, ks.lower_bound(4));
+    ASSERT_TRUE(ks.is_key_at(1, 4));
+    ASSERT_EQ(2, ks.lower_bound(5));
+    ASSERT_FALSE(ks.is_key_at(2, 5));
 }
 
-TEST(Keys, changeLastToForKeysWithMultipleElements) {
-    auto keys_factory = KeysFactoryRAII();
-    auto test_node_factory = TestNodeFactoryRAII();
-    auto ks = keys_factory.create_keys(2);
+TEST(Keys, insertAtFoundPosition) {
+    Keys<TestNode<>> ks;
+    ks.add(get_kv(1));
+    ks.add(get_kv(3));
 
-    ks.change_last_to(
-        Branch<TestNode<>>(get_kv(9), test_node_factory.create(9), test_node_factory.create(10))
-    );
+    ks.insert(ks.lower_bound(2), get_kv(2));
 
-    ASSERT_EQ(2, ks.size());
+    ASSERT_EQ(3, ks.size());
     ASSERT_EQ(1, ks.get_branch(0).kv);
-    ASSERT_EQ(1, ks.get_branch(0).left->kv);
-    ASSERT_EQ(9, ks.get_branch(0).right->kv);
-    ASSERT_EQ(9, ks.get_branch(1).kv);
-    ASSERT_EQ(9, ks.get_branch(1).left->kv);
-    ASSERT_EQ(10, ks.get_branch(1).right->kv);
+    ASSERT_EQ(2, ks.get_branch(1).kv);
+    ASSERT_EQ(3, ks.get_branch(2).kv);
 }
 
 TEST(Keys, getValueForEmptyKeys) {
-    Keys<TestNode<>> ks(10);
+    Keys<TestNode<>> ks;
 
     ASSERT_FALSE(ks.find_and_get_value(99).is_present);
 #pragma GCC diagnostic push
@@ -277,7 +246,7 @@ TEST(Keys, getValueForNoneExistantKey) {
 }
 
 TEST(Keys, getValue) {
-    Keys<TestNode<int, std::string>> ks(2);
+    Keys<TestNode<int, std::string>> ks;
 
     ks.add(KeyValue<int, std::string>(3, "a"));
 
@@ -286,7 +255,7 @@ TEST(Keys, getValue) {
 }
 
 TEST(Keys, getValueReturnsReference) {
-    Keys<TestNode<int, std::string>> ks(2);
+    Keys<TestNode<int, std::string>> ks;
     ks.add(KeyValue<int, std::string>(3, "a"));
 
     std::string& ref = ks.find_and_get_value(3);
@@ -296,4 +265,133 @@ TEST(Keys, getValueReturnsReference) {
     ASSERT_EQ("b", static_cast<std::string>(ks.find_and_get_value(3)));
 }
 
+TEST(Keys, splitLayoutIsPresent) {
+    Keys<TestNode<int, const char*, 10, split_layout>> ks;
+
+    ks.add(get_kv(3));
+    ks.add(get_kv(5));
+    ks.add(get_kv(1));
+
+    ASSERT_FALSE(ks.is_present(4));
+    ASSERT_TRUE(ks.is_present(1));
+    ASSERT_TRUE(ks.is_present(3));
+    ASSERT_TRUE(ks.is_present(5));
+}
+
+TEST(Keys, splitLayoutGetValueReturnsReference) {
+    Keys<TestNode<int, std::string, 10, split_layout>> ks;
+    ks.add(KeyValue<int, std::string>(3, "a"));
+    ks.add(KeyValue<int, std::string>(1, "c"));
+
+    std::string& ref = ks.find_and_get_value(3);
+    ref = "b";
+
+    ASSERT_EQ("c", static_cast<std::string>(ks.find_and_get_value(1)));
+    ASSERT_EQ("b", static_cast<std::string>(ks.find_and_get_value(3)));
+    ASSERT_FALSE(ks.find_and_get_value(2).is_present);
+}
+
+TEST(Keys, prefixCompressedStorageKeepsCommonPrefixOnce) {
+    using storage_t = NodeStorage<std::string, int, 8, prefix_compressed_layout>;
+    using KV = KeyValue<std::string, int>;
+    storage_t storage;
+
+    storage.insert(0, 0, KV("tenant-1/users/bob", 1));
+    ASSERT_EQ("tenant-1/users/bob", storage.common_prefix());
+
+    storage.insert(0, 1, KV("tenant-1/users/alice", 2));
+    storage.insert(2, 2, KV("tenant-1/groups", 3));
+    ASSERT_EQ("tenant-1/", storage.common_prefix());
+
+    storage.erase(2, 3);
+    ASSERT_EQ("tenant-1/users/alice", storage.key(0));
+    ASSERT_EQ("tenant-1/users/bob", storage.key(1));
+    ASSERT_EQ(1, storage.value(1));
+}
+
+TEST(Keys, prefixCompressedStorageBounds) {
+    using storage_t = NodeStorage<std::string, int, 8, prefix_compressed_layout>;
+    using KV = KeyValue<std::string, int>;
+    storage_t storage;
+    std::vector<std::string> keys = {"t/a", "t/ab", "t/b", "t/ba", "t/c"};
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        storage.insert(i, i, KV(keys[i], static_cast<int>(i)));
+    }
+    ASSERT_EQ("t/", storage.common_prefix());
+
+    for (std::string k : {"", "a", "t", "t/", "t/a", "t/aa", "t/ab", "t/abc", "t/b", "t/c", "t/d", "u"})
+    {
+        ASSERT_EQ(std::lower_bound(keys.begin(), keys.end(), k) - keys.begin(), storage.lower_bound(keys.size(), k));
+        ASSERT_EQ(std::upper_bound(keys.begin(), keys.end(), k) - keys.begin(), storage.upper_bound(keys.size(), k));
+    }
+    ASSERT_TRUE(storage.is_key(1, "t/ab"));
+    ASSERT_FALSE(storage.is_key(1, "t/abc"));
+}
+
+// the policies which go through key(i) would build a string on every comparison
+TEST(Keys, searchPoliciesLeavePrefixCompressedStorageToItsOwnSearch) {
+    using storage_t = NodeStorage<std::string, int, 8, prefix_compressed_layout>;
+    using KV = KeyValue<std::string, int>;
+    static_assert(builds_keys<storage_t>::value, "the prefix compressed storage builds its keys");
+    static_assert(!builds_keys<NodeStorage<std::string, int, 8, interleaved_layout>>::value, "the keys are stored whole");
+    storage_t storage;
+    std::vector<std::string> keys = {"t/a", "t/ab", "t/b", "t/ba", "t/c"};
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        storage.insert(i, i, KV(keys[i], static_cast<int>(i)));
+    }
+
+    for (std::string k : {"", "a", "t/", "t/ab", "t/abc", "t/c", "u"})
+    {
+        size_t lower = storage.lower_bound(keys.size(), k);
+        size_t upper = storage.upper_bound(keys.size(), k);
+        ASSERT_EQ(lower, linear_search::lower_bound(storage, keys.size(), k));
+        ASSERT_EQ(upper, linear_search::upper_bound(storage, keys.size(), k));
+        ASSERT_EQ(lower, branchless_binary_search::lower_bound(storage, keys.size(), k));
+        ASSERT_EQ(upper, branchless_binary_search::upper_bound(storage, keys.size(), k));
+        ASSERT_EQ(lower, interpolation_search::lower_bound(storage, keys.size(), k));
+        ASSERT_EQ(upper, interpolation_search::upper_bound(storage, keys.size(), k));
+    }
+}
+
+TEST(Keys, prefixCompressedStorageComparesThePrefixToo) {
+    using storage_t = NodeStorage<std::string, int, 8, prefix_compressed_layout>;
+    using KV = KeyValue<std::string, int>;
+    storage_t storage;
+    storage.insert(0, 0, KV("abc", 1));
+    storage.insert(1, 1, KV("abd", 2));
+    ASSERT_EQ("ab", storage.common_prefix());
+
+    // same length as the stored keys, the difference is inside the prefix
+    for (std::string k : {"aac", "bbc", "Abd", "abd"})
+    {
+        size_t pos = storage.lower_bound(2, k);
+        ASSERT_EQ(k == "abd", pos < 2 && storage.is_key(pos, k));
+    }
+    ASSERT_FALSE(storage.is_key(0, "aac"));
+    ASSERT_FALSE(storage.is_key(1, "xbd"));
+}
+
+TEST(Keys, prefixCompressedStorageMoveTightensPrefixes) {
+    using storage_t = NodeStorage<std::string, int, 8, prefix_compressed_layout>;
+    using KV = KeyValue<std::string, int>;
+    storage_t left;
+    storage_t right;
+    std::vector<std::string> keys = {"a/x/1", "a/x/2", "a/y/1", "a/y/2"};
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        left.insert(i, i, KV(keys[i], static_cast<int>(i)));
+    }
+    ASSERT_EQ("a/", left.common_prefix());
+
+    right.move(left, 2, 4, 0);
+
+    ASSERT_EQ("a/x/", left.common_prefix());
+    ASSERT_EQ("a/y/", right.common_prefix());
+    ASSERT_EQ("a/x/2", left.key(1));
+    ASSERT_EQ("a/y/1", right.key(0));
+    ASSERT_EQ(3, right.value(1));
+}
+
 #endif
@@ -0,0 +1 @@
+#include "test_search.hpp"
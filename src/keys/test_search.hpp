@@ -0,0 +1,132 @@
+#ifndef TEST_SEARCH_H_
+#define TEST_SEARCH_H_
+
+#include <vector>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "keys/search.hpp"
+
+
+using namespace btree;
+
+template<typename KEY>
+void check_counting_search_matches_binary_search()
+{
+    for (size_t size = 0; size < 40; size++)
+    {
+        std::vector<KEY> keys;
+        for (size_t i = 0; i < size; i++)
+        {
+            keys.push_back(static_cast<KEY>(i * 2) - static_cast<KEY>(10));
+        }
+
+        for (int n = -14; n < static_cast<int>(size * 2); n++)
+        {
+            KEY k = static_cast<KEY>(n);
+            size_t lower = std::lower_bound(keys.begin(), keys.end(), k) - keys.begin();
+            size_t upper = std::upper_bound(keys.begin(), keys.end(), k) - keys.begin();
+
+            ASSERT_EQ(lower, lower_bound_of_key(keys.data(), size, k));
+            ASSERT_EQ(upper, upper_bound_of_key(keys.data(), size, k));
+        }
+    }
+}
+
+TEST(Search, countingSearchForInt32) {
+    check_counting_search_matches_binary_search<int32_t>();
+}
+
+TEST(Search, countingSearchForInt64) {
+    check_counting_search_matches_binary_search<int64_t>();
+}
+
+TEST(Search, countingSearchForLongLong) {
+    check_counting_search_matches_binary_search<long long>();
+}
+
+TEST(Search, countingSearchForDouble) {
+    check_counting_search_matches_binary_search<double>();
+}
+
+TEST(Search, countingSearchForFloat) {
+    check_counting_search_matches_binary_search<float>();
+}
+
+TEST(Search, countingSearchForNegativeKeys) {
+    int64_t keys[] = {-500, -3, -2, 0, 7, 9, 1000};
+
+    ASSERT_EQ(0, lower_bound_of_key(keys, 7, static_cast<int64_t>(-501)));
+    ASSERT_EQ(1, upper_bound_of_key(keys, 7, static_cast<int64_t>(-500)));
+    ASSERT_EQ(3, lower_bound_of_key(keys, 7, static_cast<int64_t>(0)));
+    ASSERT_EQ(4, upper_bound_of_key(keys, 7, static_cast<int64_t>(0)));
+    ASSERT_EQ(7, lower_bound_of_key(keys, 7, static_cast<int64_t>(1001)));
+}
+
+TEST(Search, binarySearchForStrings) {
+    std::string keys[] = {"a", "b", "d"};
+
+    ASSERT_EQ(2, lower_bound_of_key(keys, 3, std::string("c")));
+    ASSERT_EQ(2, upper_bound_of_key(keys, 3, std::string("b")));
+}
+
+template<typename KEY>
+struct VectorKeys
+{
+    std::vector<KEY> keys;
+
+    const KEY & key(const size_t i) const
+    {
+        return keys[i];
+    }
+};
+
+template<class SEARCH, typename KEY>
+void check_search_policy_matches_binary_search()
+{
+    for (size_t size = 0; size < 40; size++)
+    {
+        VectorKeys<KEY> ks;
+        for (size_t i = 0; i < size; i++)
+        {
+            ks.keys.push_back(static_cast<KEY>(i * i) + static_cast<KEY>(3));
+        }
+
+        for (int n = 0; n < static_cast<int>(size * size + 10); n++)
+        {
+            KEY k = static_cast<KEY>(n);
+            size_t lower = std::lower_bound(ks.keys.begin(), ks.keys.end(), k) - ks.keys.begin();
+            size_t upper = std::upper_bound(ks.keys.begin(), ks.keys.end(), k) - ks.keys.begin();
+
+            ASSERT_EQ(lower, SEARCH::lower_bound(ks, size, k));
+            ASSERT_EQ(upper, SEARCH::upper_bound(ks, size, k));
+        }
+    }
+}
+
+TEST(Search, linearSearch) {
+    check_search_policy_matches_binary_search<linear_search, int>();
+    check_search_policy_matches_binary_search<linear_search, double>();
+}
+
+TEST(Search, branchlessBinarySearch) {
+    check_search_policy_matches_binary_search<branchless_binary_search, int>();
+    check_search_policy_matches_binary_search<branchless_binary_search, double>();
+}
+
+TEST(Search, interpolationSearch) {
+    check_search_policy_matches_binary_search<interpolation_search, int>();
+    check_search_policy_matches_binary_search<interpolation_search, uint64_t>();
+    check_search_policy_matches_binary_search<interpolation_search, double>();
+}
+
+TEST(Search, interpolationSearchForStrings) {
+    VectorKeys<std::string> ks;
+    ks.keys = {"a", "b", "d"};
+
+    ASSERT_EQ(2, interpolation_search::lower_bound(ks, 3, std::string("c")));
+    ASSERT_EQ(2, interpolation_search::upper_bound(ks, 3, std::string("b")));
+}
+
+#endif
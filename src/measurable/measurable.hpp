@@ -91,16 +91,19 @@ namespace btree
         }
     };
 
-    template <size_t degree, typename KEY = int, typename VALUE = const char*>
-    class MeasurableBtree : public Btree<KEY, VALUE, degree>, public Measurable
+    template <size_t degree, typename KEY = int, typename VALUE = const char*,
+              typename LAYOUT = interleaved_layout, typename SEARCH = default_search>
+    class MeasurableBtree : public Btree<KEY, VALUE, degree, LAYOUT, SEARCH>, public Measurable
     {
-        using btree_t = Btree<KEY, VALUE, degree>;
-        MeasurableBtree(const Keys<btree_t> ks): Btree<KEY, VALUE, degree>(ks) {}
+        using btree_t = Btree<KEY, VALUE, degree, LAYOUT, SEARCH>;
+        using pool_t = typename btree_t::pool_t;
+
+        MeasurableBtree(pool_t* pool): btree_t(pool) {}
 
     protected:
-        virtual Btree<KEY, VALUE, degree>* new_node(const Keys<btree_t> ks) override
+        virtual btree_t* new_node(pool_t* pool) override
         {
-            return new MeasurableBtree(ks);
+            return new (pool->allocate(sizeof(MeasurableBtree))) MeasurableBtree(pool);
         }
 
         virtual bool is_leaf() override
@@ -120,8 +123,15 @@ namespace btree
         }
 
     public:
-        MeasurableBtree(): Btree<KEY, VALUE, degree>() {}
-        MeasurableBtree(const MeasurableBtree & other): Btree<KEY, VALUE, degree>(other) {}
+        MeasurableBtree(): btree_t() {}
+        MeasurableBtree(const MeasurableBtree & other): btree_t(other) {}
+
+        MeasurableBtree & operator=(const MeasurableBtree & other)
+        {
+            btree_t::operator=(other);
+
+            return *this;
+        }
 
         MeasurableBtree* find_node_with_key(const int k)
         {
@@ -132,7 +142,7 @@ namespace btree
 
             for (auto it = this->keys.children_begin(); it != this->keys.children_end(); it++)
             {
-                auto result = static_cast<MeasurableBtree<degree>*>(*it)->find_node_with_key(k);
+                auto result = static_cast<MeasurableBtree*>(*it)->find_node_with_key(k);
                 if (result != nullptr)
                 {
                     return result;
@@ -3,6 +3,11 @@
 
 namespace btree
 {
+    size_t CountedValue::constructions = 0;
+    size_t CountedValue::copies = 0;
+    size_t CountingSearch::searches = 0;
+    size_t NodeCountingBtree::alive = 0;
+
     std::vector<int> input_from_file(std::string filename)
     {
         std::vector<int> result;
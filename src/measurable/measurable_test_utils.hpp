@@ -129,6 +129,199 @@ namespace btree
         check_balance(t);
     }
 
+    template<class T>
+    void test_lookups(size_t n)
+    {
+        T t;
+        for (size_t i = 0; i < n; i++)
+        {
+            t.add(i * 3, "hello");
+            t.add((2 * n - i) * 3, "world");
+        }
+
+        auto result = t.dump();
+        for (size_t i = 1; i < result.size(); i++)
+        {
+            ASSERT_LT(result[i - 1].first, result[i].first);
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            ASSERT_STREQ("hello", t.get(i * 3));
+            ASSERT_STREQ("world", t.get((2 * n - i) * 3));
+            ASSERT_THROW(t.get(i * 3 + 1), key_does_not_exist_exception);
+        }
+
+        check_balance(t);
+    }
+
+    template<size_t degree>
+    void test_top_down_split(size_t n)
+    {
+        MeasurableBtree<degree> t;
+        for (size_t i = 0; i < n; i++)
+        {
+            t.add(i * 3, "hello", top_down_split());
+            t.add((2 * n - i) * 3, "world", top_down_split());
+            t.add((i * 7919) % n * 6 + 1, "mixed", top_down_split());
+        }
+
+        auto result = t.dump();
+        ASSERT_EQ(3 * n, result.size());
+        for (size_t i = 1; i < result.size(); i++)
+        {
+            ASSERT_LT(result[i - 1].first, result[i].first);
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            ASSERT_STREQ("hello", t.get(i * 3));
+            ASSERT_STREQ("mixed", t.get(i * 6 + 1));
+        }
+
+        check_balance(t);
+    }
+
+    struct AllocationCounter
+    {
+        size_t allocations = 0;
+        size_t deallocations = 0;
+        size_t allocated_bytes = 0;
+        size_t deallocated_bytes = 0;
+    };
+
+    template<typename T>
+    struct CountingAllocator
+    {
+        using value_type = T;
+
+        AllocationCounter* counter;
+
+        CountingAllocator(AllocationCounter* counter): counter(counter) {}
+
+        template<typename U>
+        CountingAllocator(const CountingAllocator<U> & other): counter(other.counter) {}
+
+        T* allocate(size_t n)
+        {
+            counter->allocations++;
+            counter->allocated_bytes += n * sizeof(T);
+
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t n)
+        {
+            counter->deallocations++;
+            counter->deallocated_bytes += n * sizeof(T);
+            ::operator delete(p);
+        }
+
+        template<typename U>
+        bool operator==(const CountingAllocator<U> & other) const
+        {
+            return counter == other.counter;
+        }
+
+        template<typename U>
+        bool operator!=(const CountingAllocator<U> & other) const
+        {
+            return counter != other.counter;
+        }
+    };
+
+
+    // counts how many times values were built and copied
+    struct CountedValue
+    {
+        static size_t constructions;
+        static size_t copies;
+
+        int n = 0;
+
+        CountedValue() = default;
+
+        explicit CountedValue(int n): n(n)
+        {
+            constructions++;
+        }
+
+        CountedValue(const CountedValue & other): n(other.n)
+        {
+            copies++;
+        }
+
+        CountedValue(CountedValue && other) = default;
+
+        CountedValue & operator=(const CountedValue & other)
+        {
+            n = other.n;
+            copies++;
+
+            return *this;
+        }
+
+        CountedValue & operator=(CountedValue && other) = default;
+
+        static void reset() noexcept
+        {
+            constructions = 0;
+            copies = 0;
+        }
+    };
+
+
+    // search policy which counts its searches and leaves them to default_search
+    struct CountingSearch
+    {
+        static size_t searches;
+
+        template<class KEYS, typename KEY>
+        static size_t lower_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            searches++;
+
+            return default_search::lower_bound(keys, size, k);
+        }
+
+        template<class KEYS, typename KEY>
+        static size_t upper_bound(const KEYS & keys, const size_t size, const KEY & k)
+        {
+            searches++;
+
+            return default_search::upper_bound(keys, size, k);
+        }
+    };
+
+
+    // tree with trivially destructible keys and values whose nodes count how many of them are alive
+    class NodeCountingBtree : public Btree<int, int, 2>
+    {
+        using btree_t = Btree<int, int, 2>;
+
+        NodeCountingBtree(pool_t* pool): btree_t(pool)
+        {
+            alive++;
+        }
+
+    protected:
+        virtual btree_t* new_node(pool_t* pool) override
+        {
+            return new (pool->allocate(sizeof(NodeCountingBtree))) NodeCountingBtree(pool);
+        }
+
+    public:
+        static size_t alive;
+
+        NodeCountingBtree(): btree_t()
+        {
+            alive++;
+        }
+
+        ~NodeCountingBtree()
+        {
+            alive--;
+        }
+    };
+
 
     std::vector<int> input_from_file(std::string filename);
 
@@ -320,6 +320,315 @@ TEST(Btree, randomBig) {
     test_random<2>(100);
 }
 
+TEST(Btree, topDownSplit) {
+    test_top_down_split<3>(200);
+    test_top_down_split<4>(200);
+    test_top_down_split<5>(200);
+    test_top_down_split<16>(500);
+}
+
+TEST(Btree, topDownSplitDuplicateKey) {
+    MeasurableBtree<3> t;
+    for (int i = 0; i < 50; i++)
+    {
+        t.add(i, "hello", top_down_split());
+    }
+
+    for (int i = 0; i < 50; i++)
+    {
+        ASSERT_THROW(t.add(i, "world", top_down_split()), duplicated_key_exception);
+    }
+    ASSERT_EQ(50, t.dump().size());
+    ASSERT_STREQ("hello", t.get(25));
+    check_balance(t);
+}
+
+TEST(Btree, topDownAndBottomUpSplitInOneTree) {
+    MeasurableBtree<3> t;
+    for (int i = 0; i < 100; i++)
+    {
+        t.add(i * 2, "hello", top_down_split());
+        t.add(i * 2 + 1, "world");
+    }
+
+    auto result = t.dump();
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        ASSERT_EQ(i, result[i].first);
+    }
+    check_balance(t);
+}
+
+TEST(Btree, addMovesEntryIntoNode) {
+    CountedValue::reset();
+    Btree<std::string, CountedValue, 2> t;
+    for (int i = 0; i < 200; i++)
+    {
+        t.add(std::to_string(1000 + i), CountedValue(i));
+    }
+
+    ASSERT_EQ(200, CountedValue::constructions);
+    ASSERT_EQ(0, CountedValue::copies);
+    ASSERT_EQ(150, t.get("1150").n);
+}
+
+TEST(Btree, addCopiesLvaluesOnce) {
+    CountedValue::reset();
+    Btree<int, CountedValue, 3> t;
+    for (int i = 0; i < 100; i++)
+    {
+        CountedValue v(i);
+        t.add(i, v, top_down_split());
+    }
+
+    ASSERT_EQ(100, CountedValue::copies);
+}
+
+TEST(Btree, emplace) {
+    Btree<std::string, std::string, 2> t;
+    t.emplace("b", "world");
+    t.emplace(std::make_pair(std::string("a"), std::string("hello")));
+
+    ASSERT_EQ("hello", t.get("a"));
+    ASSERT_EQ("world", t.get("b"));
+    ASSERT_THROW(t.emplace("a", "again"), duplicated_key_exception);
+}
+
+TEST(Btree, tryEmplaceBuildsValueOnlyForNewKey) {
+    CountedValue::reset();
+    Btree<int, CountedValue, 2> t;
+    for (int i = 0; i < 50; i++)
+    {
+        ASSERT_TRUE(t.try_emplace(i, i * 2));
+    }
+    for (int i = 0; i < 50; i++)
+    {
+        ASSERT_FALSE(t.try_emplace(i, -1));
+    }
+
+    ASSERT_EQ(50, CountedValue::constructions);
+    ASSERT_EQ(0, CountedValue::copies);
+    ASSERT_EQ(20, t.get(10).n);
+}
+
+TEST(Btree, moveOnlyValues) {
+    using tree_t = Btree<int, std::unique_ptr<std::string>, 2>;
+    tree_t t;
+    for (int i = 0; i < 100; i++)
+    {
+        t.add(i, std::unique_ptr<std::string>(new std::string(std::to_string(i))));
+    }
+    t.emplace(100, std::unique_ptr<std::string>(new std::string("100")));
+    ASSERT_TRUE(t.try_emplace(101, new std::string("101")));
+
+    tree_t moved(std::move(t));
+    std::unique_ptr<std::string> taken = std::move(moved.get(50));
+
+    ASSERT_EQ("50", *taken);
+    ASSERT_EQ(nullptr, moved.get(50));
+    ASSERT_EQ("101", *moved.get(101));
+
+    int visited = 0;
+    moved.inorder_walk([&visited] (tree_t::reference entry) {
+        ASSERT_TRUE(entry.key == 50 || *entry.value == std::to_string(entry.key));
+        visited++;
+    });
+    ASSERT_EQ(102, visited);
+}
+
+TEST(Btree, moveOnlyValuesSplitLayout) {
+    using tree_t = Btree<int, std::unique_ptr<int>, 3, split_layout>;
+    tree_t t;
+    for (int i = 0; i < 100; i++)
+    {
+        t.add(i, std::unique_ptr<int>(new int(i * 2)), top_down_split());
+    }
+
+    ASSERT_EQ(42, *t.get(21));
+}
+
+TEST(Btree, bulkLoadMovesOnlyValues) {
+    using entry_t = std::pair<int, std::unique_ptr<int>>;
+    Btree<int, std::unique_ptr<int>, 2> t;
+    t.add(1, std::unique_ptr<int>(new int(1)));
+
+    std::vector<entry_t> input;
+    for (int i = 20; i > 1; i--)
+    {
+        input.push_back(entry_t(i, std::unique_ptr<int>(new int(i))));
+    }
+    t.bulk_load(std::make_move_iterator(input.begin()), std::make_move_iterator(input.end()));
+
+    for (int i = 1; i <= 20; i++)
+    {
+        ASSERT_EQ(i, *t.get(i));
+    }
+
+    std::vector<entry_t> duplicate;
+    duplicate.push_back(entry_t(5, std::unique_ptr<int>(new int(-5))));
+    ASSERT_THROW(
+        t.bulk_load(std::make_move_iterator(duplicate.begin()), std::make_move_iterator(duplicate.end())),
+        duplicated_key_exception);
+    ASSERT_EQ(5, *t.get(5));
+}
+
+TEST(Btree, iteratorVisitsEntriesInOrder) {
+    for (size_t n = 0; n < 60; n++)
+    {
+        auto t = tree_filled_in_mixed_order<2>(n);
+        auto expected = t.dump();
+
+        std::vector<std::pair<int, const char*>> forward(t.begin(), t.end());
+        ASSERT_EQ(expected, forward);
+
+        std::vector<std::pair<int, const char*>> backward(t.rbegin(), t.rend());
+        std::reverse(backward.begin(), backward.end());
+        ASSERT_EQ(expected, backward);
+    }
+}
+
+TEST(Btree, iteratorOfEmptyTree) {
+    MeasurableBtree<2> t;
+
+    ASSERT_TRUE(t.begin() == t.end());
+    ASSERT_TRUE(t.rbegin() == t.rend());
+}
+
+TEST(Btree, iteratorModifiesValueInPlace) {
+    Btree<int, std::string, 3, split_layout> t;
+    for (int i = 0; i < 100; i++)
+    {
+        t.add(i, "hello");
+    }
+
+    for (auto it = t.begin(); it != t.end(); it++)
+    {
+        if (it->key % 2 == 0)
+        {
+            (*it).value = "world";
+        }
+    }
+
+    ASSERT_EQ("world", t.get(10));
+    ASSERT_EQ("hello", t.get(11));
+}
+
+TEST(Btree, iteratorWorksWithStandardAlgorithms) {
+    using tree_t = Btree<int, int, 4>;
+    tree_t t;
+    for (int i = 0; i < 1000; i++)
+    {
+        t.add(i, i * 2);
+    }
+
+    ASSERT_EQ(1000, std::distance(t.begin(), t.end()));
+
+    auto it = std::find_if(t.begin(), t.end(), [] (tree_t::reference entry) {
+        return entry.value == 500;
+    });
+    ASSERT_EQ(250, it->key);
+
+    ASSERT_EQ(249, (--it)->key);
+    ASSERT_EQ(249, (it++)->key);
+    ASSERT_EQ(250, it->key);
+    ASSERT_EQ(999, (--t.end())->key);
+}
+
+TEST(Btree, constIterator) {
+    const MeasurableBtree<3> t = tree_with_incremental_elements<3>(100);
+
+    int expected = 0;
+    for (MeasurableBtree<3>::const_iterator it = t.begin(); it != t.cend(); ++it)
+    {
+        ASSERT_EQ(expected++, it->key);
+    }
+    ASSERT_EQ(100, expected);
+    ASSERT_EQ(99, t.crbegin()->key);
+}
+
+TEST(Btree, lowerAndUpperBound) {
+    for (size_t n = 0; n < 40; n++)
+    {
+        // the keys are the even numbers below 2 * n
+        MeasurableBtree<2> t;
+        std::vector<int> keys;
+        for (size_t i = 0; i < n; i++)
+        {
+            t.add(static_cast<int>(i * 2), "hello");
+            keys.push_back(static_cast<int>(i * 2));
+        }
+
+        for (int k = -1; k <= static_cast<int>(n * 2); k++)
+        {
+            auto lower = std::lower_bound(keys.begin(), keys.end(), k);
+            auto upper = std::upper_bound(keys.begin(), keys.end(), k);
+
+            ASSERT_EQ(lower - keys.begin(), std::distance(t.begin(), t.lower_bound(k)));
+            ASSERT_EQ(upper - keys.begin(), std::distance(t.begin(), t.upper_bound(k)));
+        }
+    }
+}
+
+TEST(Btree, equalRange) {
+    const MeasurableBtree<3> t = tree_with_incremental_elements<3>(50);
+
+    auto present = t.equal_range(20);
+    auto missing = t.equal_range(50);
+
+    ASSERT_EQ(1, std::distance(present.first, present.second));
+    ASSERT_EQ(20, present.first->key);
+    ASSERT_TRUE(missing.first == t.end());
+    ASSERT_TRUE(missing.second == t.end());
+}
+
+TEST(Btree, entriesAfterKey) {
+    Btree<int, int, 8> t;
+    for (int i = 0; i < 10000; i++)
+    {
+        t.add(i * 3, i);
+    }
+
+    std::vector<int> next;
+    for (auto it = t.lower_bound(3001); it != t.end() && next.size() < 100; ++it)
+    {
+        next.push_back(it->key);
+    }
+
+    ASSERT_EQ(100, next.size());
+    ASSERT_EQ(3003, next.front());
+    ASSERT_EQ(3300, next.back());
+}
+
+TEST(Btree, scan) {
+    using tree_t = Btree<int, int, 2>;
+    tree_t t;
+    for (int i = 0; i < 300; i++)
+    {
+        t.add(i * 2, i);
+    }
+
+    for (int lo = -3; lo < 610; lo += 37)
+    {
+        for (int hi = lo; hi < 620; hi += 53)
+        {
+            std::vector<int> scanned;
+            t.scan(lo, hi, [&scanned] (tree_t::reference entry) {
+                scanned.push_back(entry.key);
+            });
+
+            std::vector<int> expected;
+            for (int k = std::max(lo, 0); k < std::min(hi, 600); k++)
+            {
+                if (k % 2 == 0)
+                {
+                    expected.push_back(k);
+                }
+            }
+            ASSERT_EQ(expected, scanned);
+        }
+    }
+}
+
 TEST(Btree, preorderWalk) {
     MeasurableBtree<2> t = tree_with_incremental_elements<2>(9);
 
@@ -358,6 +667,94 @@ TEST(Btree, postorderWalk) {
     ASSERT_EQ(3, result[8]);
 }
 
+TEST(Btree, walkStopsWhenVisitorReturnsFalse) {
+    MeasurableBtree<2> t = tree_with_incremental_elements<2>(100);
+
+    std::vector<int> visited;
+    t.inorder_walk([&visited] (MeasurableBtree<2>::reference entry) {
+        visited.push_back(entry.key);
+        return entry.key < 41;
+    });
+
+    ASSERT_EQ(42, visited.size());
+    ASSERT_EQ(41, visited.back());
+}
+
+TEST(Btree, walksStopOnWalkControl) {
+    MeasurableBtree<3> t = tree_with_incremental_elements<3>(100);
+
+    size_t preorder = 0;
+    t.preorder_walk([&preorder] (MeasurableBtree<3>::reference) {
+        return ++preorder == 10 ? walk_control::stop : walk_control::proceed;
+    });
+    size_t postorder = 0;
+    t.postorder_walk([&postorder] (MeasurableBtree<3>::reference) {
+        return ++postorder < 10;
+    });
+
+    ASSERT_EQ(10, preorder);
+    ASSERT_EQ(10, postorder);
+}
+
+TEST(Btree, preorderWalkSkipsSubtree) {
+    MeasurableBtree<2> t = tree_with_incremental_elements<2>(100);
+
+    size_t visited = 0;
+    t.preorder_walk([&visited] (MeasurableBtree<2>::reference) {
+        visited++;
+        return walk_control::skip_subtree;
+    });
+
+    // only the entries of the root
+    ASSERT_EQ(t.get_keys().size(), visited);
+}
+
+TEST(Btree, inorderWalkSkipsSubtreeRightOfEntry) {
+    MeasurableBtree<2> t = tree_with_incremental_elements<2>(100);
+
+    int root_key = t.get_keys()[0].key;
+
+    std::vector<int> visited;
+    t.inorder_walk([&visited, root_key] (MeasurableBtree<2>::reference entry) {
+        visited.push_back(entry.key);
+        return entry.key == root_key ? walk_control::skip_subtree : walk_control::proceed;
+    });
+
+    // the keys between the first and the second key of the root are skipped
+    auto root_keys = t.get_keys();
+    auto skipped_from = std::find(visited.begin(), visited.end(), root_key);
+    ASSERT_EQ(root_key, skipped_from - visited.begin());
+    if (root_keys.size() > 1)
+    {
+        ASSERT_EQ(root_keys[1].key, *(skipped_from + 1));
+    }
+    else
+    {
+        ASSERT_EQ(root_key, visited.back());
+    }
+}
+
+TEST(Btree, walkModifiesValuesInPlace) {
+    using tree_t = Btree<int, std::string, 2>;
+    tree_t t;
+    for (int i = 0; i < 50; i++)
+    {
+        t.add(i, "hello");
+    }
+
+    t.inorder_walk([] (tree_t::reference entry) {
+        entry.value = std::to_string(entry.key);
+    });
+
+    const tree_t & const_t = t;
+    size_t checked = 0;
+    const_t.inorder_walk([&checked] (tree_t::const_reference entry) {
+        ASSERT_EQ(std::to_string(entry.key), entry.value);
+        checked++;
+    });
+    ASSERT_EQ(50, checked);
+}
+
 TEST(Btree, oddDegreeRoot) {
     test_incremental<3>(3);
 }
@@ -408,6 +805,43 @@ TEST(Btree, copy_assignment) {
     }
 }
 
+TEST(Btree, copyIsIndependentFromOriginal) {
+    MeasurableBtree<2> orig = tree_with_incremental_elements<2>(20);
+
+    MeasurableBtree<2> copy(orig);
+    for (int i = 20; i < 40; i++)
+    {
+        orig.add(i, "orig");
+        copy.add(-i, "copy");
+    }
+
+    auto orig_elems = orig.dump();
+    auto copied_elems = copy.dump();
+
+    ASSERT_EQ(40, orig_elems.size());
+    ASSERT_EQ(40, copied_elems.size());
+    ASSERT_EQ(0, orig_elems[0].first);
+    ASSERT_EQ(-39, copied_elems[0].first);
+    ASSERT_STREQ("orig", orig.get(39));
+    ASSERT_STREQ("copy", copy.get(-39));
+    check_balance(orig);
+    check_balance(copy);
+}
+
+TEST(Btree, moveConstruction) {
+    MeasurableBtree<2> orig = tree_with_incremental_elements<2>(10);
+    Btree<int, const char*, 2> moved(std::move(orig));
+
+    auto moved_elems = moved.dump();
+
+    ASSERT_EQ(10, moved_elems.size());
+    for (size_t i = 0; i < moved_elems.size(); i++)
+    {
+        ASSERT_EQ(i, moved_elems[i].first);
+    }
+    ASSERT_EQ(0, orig.dump().size());
+}
+
 TEST(Btree, getValueForEmptyTreeShouldThrowException) {
     MeasurableBtree<2> t = tree_with_incremental_elements<2>(0);
 
@@ -454,6 +888,81 @@ TEST(Btree, getValueReturnsReference) {
     ASSERT_STREQ("b", t.get(1));
 }
 
+TEST(Btree, findReturnsNullForMissingKey) {
+    MeasurableBtree<2> empty;
+    ASSERT_EQ(nullptr, empty.find(1));
+
+    MeasurableBtree<2> t = tree_with_incremental_elements<2>(100);
+    for (int i = 0; i < 100; i++)
+    {
+        ASSERT_STREQ("hello", *t.find(i));
+    }
+    ASSERT_EQ(nullptr, t.find(-1));
+    ASSERT_EQ(nullptr, t.find(100));
+
+    *t.find(42) = "world";
+    ASSERT_STREQ("world", t.get(42));
+}
+
+TEST(Btree, findOnConstTree) {
+    const MeasurableBtree<3> t = tree_with_incremental_elements<3>(50);
+
+    ASSERT_STREQ("hello", *t.find(10));
+    ASSERT_EQ(nullptr, t.find(50));
+    ASSERT_TRUE(t.contains(49));
+    ASSERT_FALSE(t.contains(-3));
+}
+
+TEST(Btree, tryGet) {
+    Btree<std::string, int, 2> t;
+    for (int i = 0; i < 30; i++)
+    {
+        t.add(std::to_string(i), i);
+    }
+
+    auto hit = t.try_get("17");
+    auto miss = t.try_get("170");
+
+    ASSERT_TRUE(static_cast<bool>(hit));
+    ASSERT_EQ(17, *hit);
+    ASSERT_FALSE(static_cast<bool>(miss));
+    ASSERT_THROW((void) static_cast<int &>(miss), key_does_not_exist_exception);
+}
+
+TEST(Btree, insertOrAssign) {
+    Btree<int, std::string, 2> t;
+    for (int i = 0; i < 40; i++)
+    {
+        ASSERT_TRUE(t.insert_or_assign(i, "hello"));
+    }
+    for (int i = 0; i < 40; i += 2)
+    {
+        ASSERT_FALSE(t.insert_or_assign(i, "world"));
+    }
+
+    ASSERT_EQ("world", t.get(0));
+    ASSERT_EQ("hello", t.get(1));
+    ASSERT_EQ("world", t.get(38));
+    ASSERT_EQ(40, t.dump().size());
+}
+
+TEST(Btree, upsert) {
+    Btree<std::string, int, 3> t;
+    const char* words[] = {"a", "b", "a", "c", "b", "a", "d", "e", "f", "g", "a"};
+    for (const char* word : words)
+    {
+        t.upsert(word, [] (int & count) { count++; });
+    }
+
+    ASSERT_EQ(4, t.get("a"));
+    ASSERT_EQ(2, t.get("b"));
+    ASSERT_EQ(1, t.get("g"));
+    ASSERT_FALSE(t.upsert("g", [] (int & count) { count = 10; }));
+    ASSERT_EQ(10, t.get("g"));
+    ASSERT_TRUE(t.upsert("h", [] (int & count) { count = 20; }));
+    ASSERT_EQ(20, t.get("h"));
+}
+
 TEST(Btree, storeSimpleInt) {
     Btree<int, int, 2> t;
     t.add(1, 1);
@@ -507,4 +1016,265 @@ TEST(Btree, multipleStringAsKey) {
 }
 
 
+TEST(Btree, splitLayout) {
+    MeasurableBtree<3, int, std::string, split_layout> t;
+    for (int i = 0; i < 50; i++)
+    {
+        t.add(i, std::to_string(i));
+        t.add(100 - i, std::to_string(100 - i));
+    }
+
+    t.get(42) = "changed";
+
+    auto result = t.dump();
+    ASSERT_EQ(100, result.size());
+    for (size_t i = 0; i < 50; i++)
+    {
+        ASSERT_EQ(i, result[i].first);
+        ASSERT_EQ(i + 51, result[i + 50].first);
+    }
+    ASSERT_EQ("changed", t.get(42));
+    ASSERT_EQ("7", t.get(7));
+
+    check_balance(t);
+}
+
+TEST(Btree, linearSearchPolicy) {
+    test_lookups<MeasurableBtree<4, int, const char*, interleaved_layout, linear_search>>(100);
+    test_lookups<MeasurableBtree<4, int, const char*, split_layout, linear_search>>(100);
+}
+
+TEST(Btree, branchlessBinarySearchPolicy) {
+    test_lookups<MeasurableBtree<16, int, const char*, interleaved_layout, branchless_binary_search>>(200);
+    test_lookups<MeasurableBtree<16, int, const char*, split_layout, branchless_binary_search>>(200);
+}
+
+TEST(Btree, interpolationSearchPolicy) {
+    test_lookups<MeasurableBtree<64, long, const char*, interleaved_layout, interpolation_search>>(500);
+    test_lookups<MeasurableBtree<64, long, const char*, split_layout, interpolation_search>>(500);
+}
+
+TEST(Btree, copyAssignment) {
+    MeasurableBtree<3> orig = tree_with_incremental_elements<3>(30);
+    MeasurableBtree<3> assigned = tree_with_incremental_elements<3>(5);
+
+    assigned = orig;
+    orig.add(100, "orig");
+    assigned.add(-1, "assigned");
+
+    ASSERT_EQ(31, assigned.dump().size());
+    ASSERT_EQ(-1, assigned.dump()[0].first);
+    ASSERT_EQ(31, orig.dump().size());
+    ASSERT_EQ(0, orig.dump()[0].first);
+    check_balance(orig);
+    check_balance(assigned);
+}
+
+TEST(Btree, nodesAreAllocatedWithTheAllocatorOfTheTree) {
+    using allocator_t = CountingAllocator<char>;
+    AllocationCounter counter;
+
+    {
+        Btree<int, std::string, 3, interleaved_layout, default_search, allocator_t> t{allocator_t(&counter)};
+        for (int i = 0; i < 1000; i++)
+        {
+            t.add(i, std::to_string(i));
+        }
+
+        ASSERT_EQ(&counter, t.get_allocator().counter);
+        ASSERT_LT(1, counter.allocations);
+        ASSERT_LT(1000 * sizeof(KeyValue<int, std::string>), counter.allocated_bytes);
+        ASSERT_EQ("999", t.get(999));
+    }
+
+    ASSERT_EQ(counter.allocations, counter.deallocations);
+    ASSERT_EQ(counter.allocated_bytes, counter.deallocated_bytes);
+}
+
+// the keys and values would let the pool be released without destructors, the nodes of the derived tree not
+TEST(Btree, nodesOfDerivedTreeAreDestroyed) {
+    {
+        NodeCountingBtree t;
+        for (int i = 0; i < 100; i++)
+        {
+            t.add(i, i);
+        }
+        ASSERT_LT(10, NodeCountingBtree::alive);
+    }
+
+    ASSERT_EQ(0, NodeCountingBtree::alive);
+}
+
+TEST(Btree, copyAndMoveOfTreeWithAllocator) {
+    using allocator_t = CountingAllocator<char>;
+    AllocationCounter counter;
+
+    {
+        Btree<int, int, 2, interleaved_layout, default_search, allocator_t> t{allocator_t(&counter)};
+        for (int i = 0; i < 100; i++)
+        {
+            t.add(i, i);
+        }
+
+        auto copy = t;
+        auto moved = std::move(t);
+        t.add(-1, -1);
+
+        ASSERT_EQ(&counter, copy.get_allocator().counter);
+        ASSERT_EQ(&counter, t.get_allocator().counter);
+        ASSERT_EQ(100, copy.dump().size());
+        ASSERT_EQ(100, moved.dump().size());
+        ASSERT_EQ(1, t.dump().size());
+    }
+
+    ASSERT_EQ(counter.allocations, counter.deallocations);
+}
+
+#if __cplusplus >= 201703L
+TEST(Btree, pmrTreeTakesNodesFromMemoryResource) {
+    char buffer[1 << 16];
+    std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+    pmr::Btree<int, int, 8> t(&resource);
+    for (int i = 0; i < 500; i++)
+    {
+        t.add(i, i * 2);
+    }
+
+    ASSERT_EQ(&resource, t.get_allocator().resource());
+    ASSERT_EQ(998, t.get(499));
+}
+
+TEST(Btree, pmrTreeKeepsItsResourceOnAssignmentAndSwap) {
+    std::pmr::monotonic_buffer_resource first_resource;
+    std::pmr::monotonic_buffer_resource second_resource;
+
+    pmr::Btree<int, int, 4> first(&first_resource);
+    pmr::Btree<int, int, 4> second(&second_resource);
+    for (int i = 0; i < 100; i++)
+    {
+        first.add(i, i);
+        second.add(-i, -i);
+    }
+
+    first = second;
+    ASSERT_EQ(&first_resource, first.get_allocator().resource());
+    ASSERT_EQ(second.dump(), first.dump());
+
+    second.add(1000, 1000);
+    first.swap(second);
+    ASSERT_EQ(&first_resource, first.get_allocator().resource());
+    ASSERT_EQ(&second_resource, second.get_allocator().resource());
+    ASSERT_EQ(101, first.dump().size());
+    ASSERT_EQ(1000, first.get(1000));
+    ASSERT_EQ(100, second.dump().size());
+
+    first = std::move(second);
+    ASSERT_EQ(&first_resource, first.get_allocator().resource());
+    ASSERT_EQ(100, first.dump().size());
+    ASSERT_EQ(-99, first.get(-99));
+    ASSERT_EQ(0, second.dump().size());
+}
+#endif
+
+TEST(Btree, bulkLoadSortedRange) {
+    for (size_t n = 0; n < 120; n++)
+    {
+        std::vector<std::pair<int, const char*>> input;
+        for (size_t i = 0; i < n; i++)
+        {
+            input.push_back(std::make_pair(static_cast<int>(i * 2), "hello"));
+        }
+
+        MeasurableBtree<2> t;
+        t.bulk_load(input.begin(), input.end());
+
+        ASSERT_EQ(input, t.dump());
+        check_balance(t);
+    }
+}
+
+TEST(Btree, bulkLoadWithFillFactor) {
+    std::vector<std::pair<int, const char*>> input;
+    for (int i = 0; i < 1000; i++)
+    {
+        input.push_back(std::make_pair(i * 2, "hello"));
+    }
+
+    for (double fill_factor : {0.1, 0.5, 0.7, 1.0})
+    {
+        MeasurableBtree<5> t;
+        t.bulk_load(input.begin(), input.end(), fill_factor);
+
+        ASSERT_EQ(input, t.dump());
+        check_balance(t);
+
+        for (int i = 0; i < 1000; i++)
+        {
+            t.add(i * 2 + 1, "world");
+        }
+
+        ASSERT_EQ(2000, t.dump().size());
+        ASSERT_STREQ("hello", t.get(998));
+        ASSERT_STREQ("world", t.get(999));
+        check_balance(t);
+    }
+}
+
+TEST(Btree, bulkLoadUnsortedRange) {
+    std::vector<std::pair<int, const char*>> input = {{5, "e"}, {1, "a"}, {3, "c"}, {2, "b"}, {4, "d"}};
+
+    MeasurableBtree<2> t;
+    t.bulk_load(input.begin(), input.end());
+
+    auto result = t.dump();
+    ASSERT_EQ(5, result.size());
+    for (int i = 0; i < 5; i++)
+    {
+        ASSERT_EQ(i + 1, result[i].first);
+    }
+    ASSERT_STREQ("c", t.get(3));
+    check_balance(t);
+}
+
+TEST(Btree, bulkLoadIntoNonEmptyTree) {
+    MeasurableBtree<3> t = tree_with_incremental_elements<3>(10);
+    std::vector<KeyValue<int, const char*>> input = {{-2, "world"}, {-1, "world"}, {20, "world"}};
+
+    t.bulk_load(input.begin(), input.end());
+
+    auto result = t.dump();
+    ASSERT_EQ(13, result.size());
+    ASSERT_EQ(-2, result[0].first);
+    ASSERT_EQ(20, result[12].first);
+    check_balance(t);
+}
+
+TEST(Btree, bulkLoadDuplicateKeyLeavesTreeUnchanged) {
+    MeasurableBtree<2> t = tree_with_incremental_elements<2>(5);
+    std::vector<std::pair<int, const char*>> input = {{7, "world"}, {3, "world"}};
+
+    ASSERT_THROW(t.bulk_load(input.begin(), input.end()), duplicated_key_exception);
+    ASSERT_EQ(5, t.dump().size());
+}
+
+TEST(Btree, bulkLoadConstructor) {
+    std::vector<std::pair<std::string, int>> input = {{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}};
+
+    Btree<std::string, int, 2> t(input.begin(), input.end());
+
+    ASSERT_EQ(input, t.dump());
+    ASSERT_EQ(3, t.get("c"));
+}
+
+TEST(Btree, clear) {
+    MeasurableBtree<2> t = tree_with_incremental_elements<2>(50);
+
+    t.clear();
+    t.add(1, "hello");
+
+    ASSERT_EQ(1, t.dump().size());
+    check_balance(t);
+}
+
 #endif
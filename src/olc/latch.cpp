@@ -0,0 +1 @@
+#include "latch.hpp"
@@ -0,0 +1,77 @@
+#ifndef LATCH_H_
+#define LATCH_H_
+
+#include<atomic>
+#include<cstdint>
+#include<thread>
+
+
+namespace btree
+{
+    // Version latch of a node for optimistic lock coupling.
+    // The version is even while the latch is free and odd while a writer holds it, every write lock
+    // moves it on. A reader remembers the version, reads the node without taking anything and checks
+    // the version afterwards: if it moved on, what was read may be torn and the reader starts again.
+    class OptimisticLatch
+    {
+    private:
+        std::atomic<uint64_t> version{0};
+
+    public:
+        // waits while a writer holds the latch
+        uint64_t read_begin() const noexcept
+        {
+            uint64_t v = version.load(std::memory_order_acquire);
+            while (is_locked(v))
+            {
+                std::this_thread::yield();
+                v = version.load(std::memory_order_acquire);
+            }
+
+            return v;
+        }
+
+        // true if nothing was written since read_begin returned v
+        bool validate(const uint64_t v) const noexcept
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            return version.load(std::memory_order_relaxed) == v;
+        }
+
+        // Write locks the latch if it is still at version v. It does not wait, a writer which fails
+        // starts again from the root, so writers never wait for each other while holding a latch.
+        bool try_upgrade(uint64_t v) noexcept
+        {
+            if (!version.compare_exchange_strong(v, v + 1, std::memory_order_acquire))
+            {
+                return false;
+            }
+            // the writes to the node must not become visible before the odd version
+            std::atomic_thread_fence(std::memory_order_release);
+
+            return true;
+        }
+
+        // waits until the latch is free and write locks it
+        void lock() noexcept
+        {
+            while (!try_upgrade(read_begin()))
+            {
+            }
+        }
+
+        void unlock() noexcept
+        {
+            version.fetch_add(1, std::memory_order_release);
+        }
+
+    private:
+        static bool is_locked(const uint64_t v) noexcept
+        {
+            return (v & 1) == 1;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1 @@
+#include "olc_btree.hpp"
@@ -0,0 +1,517 @@
+#ifndef OLC_BTREE_H_
+#define OLC_BTREE_H_
+
+#include<algorithm>
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+#include<memory>
+#include<mutex>
+#include<new>
+#include<type_traits>
+#include<utility>
+#include<vector>
+
+#include "keys/keys.hpp"
+#include "olc/latch.hpp"
+#include "pool/pool.hpp"
+
+
+namespace btree
+{
+    // Concurrent B+tree with optimistic lock coupling. Readers do not write to the nodes at all: they go
+    // down from the root remembering the version of every node they read and checking it after they
+    // read the next one, and start again when a writer got in between. Writers go down the same way and
+    // write lock only the nodes they change. A full node met on the way is split before going further,
+    // so a split locks only the node and its parent.
+    // Nodes are read while a writer may be changing them, so the keys and the values have to be trivially
+    // copyable, what a torn read returns is thrown away by the version check. Inserts never remove nodes,
+    // the nodes are freed with the tree.
+    template <typename KEY, typename VALUE, size_t DEGREE,
+              typename SEARCH = default_search, typename ALLOCATOR = std::allocator<char>>
+    class OlcBtree
+    {
+        static_assert(std::is_trivially_copyable<KEY>::value && std::is_trivially_copyable<VALUE>::value,
+            "nodes are read while they are written, keys and values have to be trivially copyable");
+        // a full inner node gives its middle separator to the parent, the rest has to keep one on each side
+        static_assert(DEGREE >= 3, "an inner split has to leave a separator on both sides");
+
+    public:
+        static const size_t degree = DEGREE;
+
+        using key_t = KEY;
+        using value_t = VALUE;
+        using search_t = SEARCH;
+        using allocator_t = ALLOCATOR;
+        // scans hand out copies of the entries, which were checked to be consistent
+        using const_reference = KeyValueRef<KEY, const VALUE>;
+
+    private:
+        using KV = KeyValue<key_t, value_t>;
+        using KV_pair = std::pair<key_t, value_t>;
+        using pool_t = NodePool<ALLOCATOR>;
+
+        enum class outcome { restart, added, present };
+
+        // Size and next are read without the latch too, so they are relaxed atomics written under the
+        // latch, the latch orders them with the entries. A reader never trusts size beyond DEGREE. The
+        // entries themselves are read optimistically and used only once the version is validated.
+        struct Node
+        {
+            OptimisticLatch latch;
+            const bool is_leaf;
+            std::atomic<size_t> size{0};
+
+            Node(const bool is_leaf): is_leaf(is_leaf) {}
+
+            size_t size_to_read() const noexcept
+            {
+                return std::min(size.load(std::memory_order_relaxed), DEGREE);
+            }
+
+            void set_size(const size_t new_size) noexcept
+            {
+                size.store(new_size, std::memory_order_relaxed);
+            }
+        };
+
+        struct Leaf: Node
+        {
+            NodeStorage<KEY, VALUE, DEGREE, split_layout> entries;
+            std::atomic<Leaf*> next{nullptr};
+
+            Leaf(): Node(true) {}
+        };
+
+        // child i + 1 is stored with separator i, as in BplusTree
+        struct Inner: Node
+        {
+            Node* first_child = nullptr;
+            NodeStorage<KEY, Node*, DEGREE, split_layout> separators;
+
+            Inner(): Node(false) {}
+
+            Node* child(const size_t i) noexcept
+            {
+                return i == 0 ? first_child : separators.value(i - 1);
+            }
+
+            size_t child_for_key(const KEY & k) const
+            {
+                return search_t::upper_bound(separators, this->size_to_read(), k);
+            }
+        };
+
+        // the pools are shared by the writers, they are locked only to split
+        std::mutex pool_mutex;
+        pool_t* leaf_pool;
+        pool_t* inner_pool;
+        std::atomic<Node*> root;
+        // splits move entries to the right, the first leaf stays the first one
+        Leaf* first_leaf;
+
+    public:
+        explicit OlcBtree(const ALLOCATOR & allocator = ALLOCATOR())
+            : leaf_pool(create_pool(allocator)), inner_pool(create_pool(allocator))
+        {
+            first_leaf = new_leaf();
+            root.store(first_leaf, std::memory_order_release);
+        }
+
+        OlcBtree(const OlcBtree &) = delete;
+        OlcBtree & operator=(const OlcBtree &) = delete;
+
+        ALLOCATOR get_allocator() const
+        {
+            return leaf_pool->get_allocator();
+        }
+
+        // Throws duplicated_key_exception if k is present.
+        void add(const key_t & k, const value_t & v)
+        {
+            if (!insert(k, v, false))
+            {
+                BTREE_THROW(duplicated_key_exception());
+            }
+        }
+
+        // Assigns v to k if k is present, adds them otherwise. Returns true if k was added.
+        bool insert_or_assign(const key_t & k, const value_t & v)
+        {
+            return insert(k, v, true);
+        }
+
+        // Copies the value of k to value. Returns false if k is not present.
+        bool find(const key_t & k, value_t & value) const
+        {
+            while (true)
+            {
+                uint64_t version = 0;
+                Leaf* leaf = find_leaf(k, version);
+                if (leaf == nullptr)
+                {
+                    continue;
+                }
+
+                size_t size = leaf->size_to_read();
+                size_t pos = search_t::lower_bound(leaf->entries, size, k);
+                bool found = pos < size && !(k < leaf->entries.key(pos));
+                value_t result = found ? leaf->entries.value(pos) : value_t();
+                if (!leaf->latch.validate(version))
+                {
+                    continue;
+                }
+
+                if (found)
+                {
+                    value = result;
+                }
+
+                return found;
+            }
+        }
+
+        bool contains(const key_t & k) const
+        {
+            value_t value;
+
+            return find(k, value);
+        }
+
+        value_t get(const key_t & k) const
+        {
+            value_t value;
+            if (!find(k, value))
+            {
+                BTREE_THROW(key_does_not_exist_exception());
+            }
+
+            return value;
+        }
+
+        // Calls visit with the entries whose key is in [lo, hi) in key order. Every leaf is copied and
+        // checked before its entries are visited, so a scan along writers sees each key once and in order,
+        // but not a snapshot of the whole range.
+        template<typename VISITOR>
+        void scan(const key_t & lo, const key_t & hi, VISITOR visit) const
+        {
+            scan_leaves(&lo, &hi, visit);
+        }
+
+        std::vector<KV_pair> dump() const
+        {
+            std::vector<KV_pair> entries;
+            scan_leaves(nullptr, nullptr, [&entries] (const_reference entry) {
+                entries.push_back(entry);
+            });
+
+            return entries;
+        }
+
+        // number of levels, a tree with only a root leaf has height 1
+        size_t height() const noexcept
+        {
+            size_t result = 1;
+            for (Node* n = root.load(std::memory_order_acquire); !n->is_leaf; n = static_cast<Inner*>(n)->first_child)
+            {
+                result++;
+            }
+
+            return result;
+        }
+
+        // the keys and the values are trivially destructible, the nodes go away with the pools
+        ~OlcBtree()
+        {
+            destroy_pool(leaf_pool);
+            destroy_pool(inner_pool);
+        }
+
+    private:
+        bool insert(const key_t & k, const value_t & v, const bool assign)
+        {
+            while (true)
+            {
+                outcome result = try_insert(k, v, assign);
+                if (result != outcome::restart)
+                {
+                    return result == outcome::added;
+                }
+            }
+        }
+
+        // Goes down to the leaf of k and returns it with the version it was read at,
+        // nullptr if a writer got in the way.
+        Leaf* find_leaf(const key_t & k, uint64_t & version) const
+        {
+            Node* node = root.load(std::memory_order_acquire);
+            uint64_t node_version = node->latch.read_begin();
+            if (node != root.load(std::memory_order_acquire))
+            {
+                return nullptr;
+            }
+
+            while (!node->is_leaf)
+            {
+                Inner* inner = static_cast<Inner*>(node);
+                Node* child = inner->child(inner->child_for_key(k));
+                if (!inner->latch.validate(node_version))
+                {
+                    return nullptr;
+                }
+
+                uint64_t child_version = child->latch.read_begin();
+                if (!inner->latch.validate(node_version))
+                {
+                    return nullptr;
+                }
+
+                node = child;
+                node_version = child_version;
+            }
+
+            version = node_version;
+
+            return static_cast<Leaf*>(node);
+        }
+
+        outcome try_insert(const key_t & k, const value_t & v, const bool assign)
+        {
+            Node* node = root.load(std::memory_order_acquire);
+            uint64_t version = node->latch.read_begin();
+            if (node != root.load(std::memory_order_acquire))
+            {
+                return outcome::restart;
+            }
+
+            Inner* parent = nullptr;
+            uint64_t parent_version = 0;
+            while (true)
+            {
+                if (node->size_to_read() == DEGREE)
+                {
+                    split(parent, parent_version, node, version);
+
+                    return outcome::restart;
+                }
+
+                if (node->is_leaf)
+                {
+                    break;
+                }
+
+                Inner* inner = static_cast<Inner*>(node);
+                Node* child = inner->child(inner->child_for_key(k));
+                if (!inner->latch.validate(version))
+                {
+                    return outcome::restart;
+                }
+
+                uint64_t child_version = child->latch.read_begin();
+                if (!inner->latch.validate(version))
+                {
+                    return outcome::restart;
+                }
+
+                parent = inner;
+                parent_version = version;
+                node = child;
+                version = child_version;
+            }
+
+            Leaf* leaf = static_cast<Leaf*>(node);
+            if (!leaf->latch.try_upgrade(version))
+            {
+                return outcome::restart;
+            }
+
+            size_t size = leaf->size_to_read();
+            size_t pos = search_t::lower_bound(leaf->entries, size, k);
+            if (pos < size && !(k < leaf->entries.key(pos)))
+            {
+                if (assign)
+                {
+                    leaf->entries.value(pos) = v;
+                }
+                leaf->latch.unlock();
+
+                return outcome::present;
+            }
+
+            leaf->entries.insert(pos, size, KV(k, v));
+            leaf->set_size(size + 1);
+            leaf->latch.unlock();
+
+            return outcome::added;
+        }
+
+        // Splits the full node and adds the separator to its parent, which is not full, or grows the tree
+        // when the node is the root. Gives up if either of them changed since it was read.
+        void split(Inner* parent, const uint64_t parent_version, Node* node, const uint64_t version)
+        {
+            if (parent != nullptr && !parent->latch.try_upgrade(parent_version))
+            {
+                return;
+            }
+
+            if (!node->latch.try_upgrade(version))
+            {
+                if (parent != nullptr)
+                {
+                    parent->latch.unlock();
+                }
+
+                return;
+            }
+
+            KeyValue<KEY, Node*> separator =
+                node->is_leaf ? split(static_cast<Leaf*>(node)) : split(static_cast<Inner*>(node));
+
+            if (parent == nullptr)
+            {
+                grow(node, std::move(separator));
+                node->latch.unlock();
+
+                return;
+            }
+
+            size_t pos = parent->child_for_key(separator.key);
+            size_t parent_size = parent->size_to_read();
+            parent->separators.insert(pos, parent_size, std::move(separator));
+            parent->set_size(parent_size + 1);
+
+            node->latch.unlock();
+            parent->latch.unlock();
+        }
+
+        KeyValue<KEY, Node*> split(Leaf* leaf)
+        {
+            Leaf* right = new_leaf();
+            size_t size = leaf->size_to_read();
+            size_t half = size / 2;
+            right->entries.move(leaf->entries, half, size, 0);
+            right->set_size(size - half);
+            right->next.store(leaf->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+            leaf->set_size(half);
+            leaf->next.store(right, std::memory_order_relaxed);
+
+            return KeyValue<KEY, Node*>(right->entries.key(0), right);
+        }
+
+        // the middle separator is returned with the new right node, its child becomes the first child there
+        KeyValue<KEY, Node*> split(Inner* inner)
+        {
+            Inner* right = new_inner();
+            size_t size = inner->size_to_read();
+            size_t middle = size / 2;
+            right->separators.move(inner->separators, middle + 1, size, 0);
+            right->set_size(size - middle - 1);
+
+            KeyValue<KEY, Node*> separator = inner->separators.take(middle);
+            inner->set_size(middle);
+            right->first_child = separator.value;
+            separator.value = right;
+
+            return separator;
+        }
+
+        // the old root is write locked, so no writer can reach it and nobody else grows the tree
+        void grow(Node* old_root, KeyValue<KEY, Node*> && separator)
+        {
+            Inner* new_root = new_inner();
+            new_root->first_child = old_root;
+            new_root->separators.insert(0, 0, std::move(separator));
+            new_root->set_size(1);
+            root.store(new_root, std::memory_order_release);
+        }
+
+        // Visits the entries in [lo, hi), a null bound is open. After a restart the scan goes on
+        // after the last key it visited.
+        template<typename VISITOR>
+        void scan_leaves(const key_t * lo, const key_t * hi, VISITOR visit) const
+        {
+            KV entries[DEGREE];
+            key_t last = key_t();
+            bool visited_any = false;
+
+            while (true)
+            {
+                uint64_t version = 0;
+                Leaf* leaf = nullptr;
+                if (visited_any || lo != nullptr)
+                {
+                    leaf = find_leaf(visited_any ? last : *lo, version);
+                }
+                else
+                {
+                    leaf = first_leaf;
+                    version = leaf->latch.read_begin();
+                }
+
+                while (leaf != nullptr)
+                {
+                    size_t size = leaf->size_to_read();
+                    size_t count = 0;
+                    bool reached_hi = false;
+                    for (size_t i = 0; i < size && !reached_hi; i++)
+                    {
+                        const key_t & k = leaf->entries.key(i);
+                        reached_hi = hi != nullptr && !(k < *hi);
+                        if (!reached_hi && (visited_any ? last < k : lo == nullptr || !(k < *lo)))
+                        {
+                            entries[count++] = KV(k, leaf->entries.value(i));
+                        }
+                    }
+
+                    Leaf* next = leaf->next.load(std::memory_order_relaxed);
+                    if (!leaf->latch.validate(version))
+                    {
+                        break;
+                    }
+
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        visit(const_reference(entries[i].key, entries[i].value));
+                    }
+
+                    if (count > 0)
+                    {
+                        last = entries[count - 1].key;
+                        visited_any = true;
+                    }
+
+                    if (reached_hi || next == nullptr)
+                    {
+                        return;
+                    }
+
+                    uint64_t next_version = next->latch.read_begin();
+                    if (!leaf->latch.validate(version))
+                    {
+                        break;
+                    }
+
+                    leaf = next;
+                    version = next_version;
+                }
+            }
+        }
+
+        Leaf* new_leaf()
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+
+            return new (leaf_pool->allocate(sizeof(Leaf))) Leaf();
+        }
+
+        Inner* new_inner()
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+
+            return new (inner_pool->allocate(sizeof(Inner))) Inner();
+        }
+    };
+}
+
+#endif
@@ -0,0 +1 @@
+#include "test_olc_btree.hpp"
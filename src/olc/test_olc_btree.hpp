@@ -0,0 +1,101 @@
+#ifndef TEST_OLC_BTREE_H_
+#define TEST_OLC_BTREE_H_
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "olc/olc_btree.hpp"
+
+
+using namespace btree;
+
+// Every writer adds its keys in increasing order, a reader which finds a key of a writer
+// has to find the previous one of that writer too.
+TEST(OlcBtree, concurrentWritersAndReaders) {
+    const int writers = 4;
+    const int keys_per_writer = 5000;
+    OlcBtree<int, int, 8> t;
+    std::atomic<bool> writing{true};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; w++)
+    {
+        threads.emplace_back([&t, w] {
+            for (int i = 0; i < keys_per_writer; i++)
+            {
+                t.add(i * writers + w, i);
+            }
+        });
+    }
+    for (int r = 0; r < 4; r++)
+    {
+        threads.emplace_back([&t, &writing, &errors, r] {
+            std::mt19937 random(r);
+            while (writing.load())
+            {
+                int k = random() % (writers * keys_per_writer);
+                int value = -1;
+                if (t.find(k, value) && (value != k / writers || (k >= writers && !t.contains(k - writers))))
+                {
+                    errors++;
+                }
+            }
+        });
+    }
+
+    for (int w = 0; w < writers; w++)
+    {
+        threads[w].join();
+    }
+    writing.store(false);
+    for (size_t i = writers; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    ASSERT_EQ(0, errors.load());
+    std::vector<std::pair<int, int>> entries = t.dump();
+    ASSERT_EQ(writers * keys_per_writer, entries.size());
+    for (int k = 0; k < writers * keys_per_writer; k++)
+    {
+        ASSERT_EQ(std::make_pair(k, k / writers), entries[k]);
+    }
+}
+
+TEST(OlcBtree, scansAlongWritersSeeOrderedKeys) {
+    using tree_t = OlcBtree<int, int, 4>;
+    tree_t t;
+    std::atomic<bool> writing{true};
+    std::atomic<int> errors{0};
+
+    std::thread writer([&t, &writing] {
+        std::mt19937 random(1);
+        for (int i = 0; i < 20000; i++)
+        {
+            t.insert_or_assign(random() % 100000, i);
+        }
+        writing.store(false);
+    });
+
+    while (writing.load())
+    {
+        int previous = -1;
+        t.scan(1000, 90000, [&previous, &errors] (tree_t::const_reference entry) {
+            if (entry.key <= previous || entry.key < 1000 || entry.key >= 90000)
+            {
+                errors++;
+            }
+            previous = entry.key;
+        });
+    }
+    writer.join();
+
+    ASSERT_EQ(0, errors.load());
+}
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include<algorithm>
+#include<cstddef>
+#include<memory>
+#include<assert.h>
+
+
+namespace btree
+{
+    // Slab allocator for the nodes of one tree.
+    // Slots of one size are cut from big blocks by bumping a pointer, released slots are kept on
+    // a free list and handed out again before the current block is touched. The blocks come from
+    // ALLOCATOR and are returned together when the pool is destroyed, so the nodes of a tree stay
+    // close to each other in memory.
+    template<typename ALLOCATOR = std::allocator<char>>
+    class NodePool
+    {
+    private:
+        using unit_t = std::max_align_t;
+        using unit_allocator_t = typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<unit_t>;
+        using unit_traits = std::allocator_traits<unit_allocator_t>;
+
+        // stored at the beginning of every block, the blocks of the pool form a list
+        struct Block
+        {
+            Block* next;
+            size_t units;
+        };
+
+        struct FreeSlot
+        {
+            FreeSlot* next;
+        };
+
+        static const size_t first_block_slots = 8;
+        static const size_t max_block_slots = 1024;
+
+        unit_allocator_t allocator;
+        size_t slot_size = 0;
+        size_t block_slots = first_block_slots;
+        Block* blocks = nullptr;
+        char* next_slot = nullptr;
+        char* block_end = nullptr;
+        FreeSlot* free_slots = nullptr;
+
+    public:
+        explicit NodePool(const ALLOCATOR & allocator = ALLOCATOR()): allocator(allocator) {}
+        NodePool(const NodePool &) = delete;
+        NodePool & operator=(const NodePool &) = delete;
+
+        ALLOCATOR get_allocator() const
+        {
+            return ALLOCATOR(allocator);
+        }
+
+        void* allocate(const size_t size)
+        {
+            if (slot_size == 0)
+            {
+                slot_size = std::max(units_for(size), units_for(sizeof(FreeSlot))) * sizeof(unit_t);
+            }
+
+            assert(size <= slot_size);
+
+            if (free_slots != nullptr)
+            {
+                void* slot = free_slots;
+                free_slots = free_slots->next;
+
+                return slot;
+            }
+
+            if (next_slot == block_end)
+            {
+                add_block();
+            }
+
+            void* slot = next_slot;
+            next_slot += slot_size;
+
+            return slot;
+        }
+
+        void release(void* slot) noexcept
+        {
+            auto released = static_cast<FreeSlot*>(slot);
+            released->next = free_slots;
+            free_slots = released;
+        }
+
+        ~NodePool()
+        {
+            while (blocks != nullptr)
+            {
+                Block* next = blocks->next;
+                unit_traits::deallocate(allocator, reinterpret_cast<unit_t*>(blocks), blocks->units);
+                blocks = next;
+            }
+        }
+
+    private:
+        static size_t units_for(const size_t size) noexcept
+        {
+            return (size + sizeof(unit_t) - 1) / sizeof(unit_t);
+        }
+
+        void add_block()
+        {
+            size_t header_units = units_for(sizeof(Block));
+            size_t units = header_units + slot_size / sizeof(unit_t) * block_slots;
+            unit_t* memory = unit_traits::allocate(allocator, units);
+
+            Block* block = reinterpret_cast<Block*>(memory);
+            block->next = blocks;
+            block->units = units;
+            blocks = block;
+
+            next_slot = reinterpret_cast<char*>(memory + header_units);
+            block_end = reinterpret_cast<char*>(memory + units);
+            block_slots = std::min(block_slots * 2, max_block_slots);
+        }
+    };
+
+    template<typename ALLOCATOR>
+    const size_t NodePool<ALLOCATOR>::first_block_slots;
+
+    template<typename ALLOCATOR>
+    const size_t NodePool<ALLOCATOR>::max_block_slots;
+
+
+    // The pool of a tree is allocated with the allocator of the tree too. It lives apart from the tree,
+    // so a moved tree can take its pool along.
+    template<typename ALLOCATOR>
+    NodePool<ALLOCATOR>* create_pool(const ALLOCATOR & allocator)
+    {
+        using pool_allocator_t = typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<NodePool<ALLOCATOR>>;
+        using pool_traits = std::allocator_traits<pool_allocator_t>;
+
+        pool_allocator_t pool_allocator(allocator);
+        NodePool<ALLOCATOR>* pool = pool_traits::allocate(pool_allocator, 1);
+        pool_traits::construct(pool_allocator, pool, allocator);
+
+        return pool;
+    }
+
+    template<typename ALLOCATOR>
+    void destroy_pool(NodePool<ALLOCATOR>* pool) noexcept
+    {
+        using pool_allocator_t = typename std::allocator_traits<ALLOCATOR>::template rebind_alloc<NodePool<ALLOCATOR>>;
+        using pool_traits = std::allocator_traits<pool_allocator_t>;
+
+        pool_allocator_t pool_allocator(pool->get_allocator());
+        pool_traits::destroy(pool_allocator, pool);
+        pool_traits::deallocate(pool_allocator, pool, 1);
+    }
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TEST_POOL_H_
+#define TEST_POOL_H_
+
+#include <set>
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+#include "pool/pool.hpp"
+
+
+using namespace btree;
+
+TEST(NodePool, allocatesDistinctAlignedSlots) {
+    NodePool<> pool;
+    std::set<void*> slots;
+
+    for (size_t i = 0; i < 1000; i++)
+    {
+        void* slot = pool.allocate(40);
+        ASSERT_EQ(0, reinterpret_cast<uintptr_t>(slot) % alignof(std::max_align_t));
+        slots.insert(slot);
+    }
+
+    ASSERT_EQ(1000, slots.size());
+}
+
+TEST(NodePool, slotsOfABlockAreAdjacent) {
+    NodePool<> pool;
+
+    char* first = static_cast<char*>(pool.allocate(64));
+    char* second = static_cast<char*>(pool.allocate(64));
+
+    ASSERT_EQ(first + 64, second);
+}
+
+TEST(NodePool, releasedSlotIsReused) {
+    NodePool<> pool;
+    pool.allocate(24);
+    void* slot = pool.allocate(24);
+    pool.allocate(24);
+
+    pool.release(slot);
+
+    ASSERT_EQ(slot, pool.allocate(24));
+}
+
+TEST(NodePool, releasedSlotsAreReusedInReverseOrder) {
+    NodePool<> pool;
+    void* first = pool.allocate(24);
+    void* second = pool.allocate(24);
+
+    pool.release(first);
+    pool.release(second);
+
+    ASSERT_EQ(second, pool.allocate(24));
+    ASSERT_EQ(first, pool.allocate(24));
+}
+
+#endif
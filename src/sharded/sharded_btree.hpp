@@ -0,0 +1,427 @@
+#ifndef SHARDED_BTREE_H_
+#define SHARDED_BTREE_H_
+
+#include<algorithm>
+#include<array>
+#include<atomic>
+#include<cstddef>
+#include<iterator>
+#include<memory>
+#include<mutex>
+#include<utility>
+#include<vector>
+
+#include "btree/btree.hpp"
+#include "epoch/epoch.hpp"
+
+
+namespace btree
+{
+    // Btree split by key ranges into SHARDS independent trees, each behind its own mutex and with its own
+    // node pool, so writers of different ranges do not wait for each other. Shard i holds the keys in
+    // [boundary i - 1, boundary i), the first and the last shards are open to the left and to the right.
+    // Scans stay ordered: they go through the shards of the range one after the other.
+    // A shard which holds much more than its share of the entries is hot; once the tree grew enough since
+    // the last rebalance, the boundary between it and its smaller neighbour is moved so that the two hold
+    // the same number of entries.
+    // Every thread which uses the tree registers a participant and passes it along, the participants go
+    // away before the tree.
+    template <typename KEY, typename VALUE, size_t DEGREE, size_t SHARDS,
+              typename LAYOUT = interleaved_layout, typename SEARCH = default_search,
+              typename ALLOCATOR = std::allocator<char>>
+    class ShardedBtree
+    {
+        static_assert(SHARDS >= 1, "there is at least one shard");
+
+    public:
+        static const size_t degree = DEGREE;
+        static const size_t shards = SHARDS;
+        // a shard is not rebalanced below this size
+        static const size_t min_rebalanced_size = 1024;
+        // a shard checks whether it is hot every this many added entries
+        static const size_t hot_check_interval = 64;
+
+        using key_t = KEY;
+        using value_t = VALUE;
+        using tree_t = Btree<KEY, VALUE, DEGREE, LAYOUT, SEARCH, ALLOCATOR>;
+        // the visitor of a scan gets the entries in place, while their shard is locked
+        using const_reference = typename tree_t::const_reference;
+        using participant_t = EpochManager::Participant;
+
+    private:
+        using KV = KeyValue<key_t, value_t>;
+        using KV_pair = std::pair<key_t, value_t>;
+        using boundaries_t = std::vector<KEY>;
+
+        // the size changes under the mutex, it is read without it to sum up the size of the tree
+        struct Shard
+        {
+            std::mutex mutex;
+            tree_t tree;
+            std::atomic<size_t> size{0};
+
+            explicit Shard(const ALLOCATOR & allocator): tree(allocator) {}
+        };
+
+        std::unique_ptr<Shard> shard_list[SHARDS];
+        // The boundaries are replaced only while the shards whose ranges change are locked. They are read
+        // without a lock while the epoch of the participant is pinned, the replaced ones are retired to the
+        // epoch manager.
+        EpochManager epochs;
+        std::atomic<boundaries_t*> boundaries;
+        std::mutex rebalance_mutex;
+        std::atomic<size_t> total_at_rebalance{0};
+
+    public:
+        explicit ShardedBtree(const ALLOCATOR & allocator = ALLOCATOR()): ShardedBtree(boundaries_t(), allocator) {}
+
+        // initial_boundaries are sorted and at most SHARDS - 1, the shards above them stay empty until
+        // the first rebalance
+        explicit ShardedBtree(boundaries_t initial_boundaries, const ALLOCATOR & allocator = ALLOCATOR())
+        {
+            for (std::unique_ptr<Shard> & shard : shard_list)
+            {
+                shard.reset(new Shard(allocator));
+            }
+
+            initial_boundaries.resize(std::min(initial_boundaries.size(), SHARDS - 1));
+            boundaries.store(new boundaries_t(std::move(initial_boundaries)), std::memory_order_release);
+        }
+
+        ShardedBtree(const ShardedBtree &) = delete;
+        ShardedBtree & operator=(const ShardedBtree &) = delete;
+
+        // Registers the calling thread, it passes the returned participant to the other calls.
+        // Throws too_many_participants_exception if EpochManager::max_participants are registered.
+        participant_t participant()
+        {
+            return participant_t(epochs);
+        }
+
+        // Throws duplicated_key_exception if k is present.
+        template<typename K, typename V>
+        void add(participant_t & participant, K && k, V && v)
+        {
+            std::unique_lock<std::mutex> lock;
+            Shard & shard = lock_shard_of(participant, k, lock);
+            shard.tree.add(std::forward<K>(k), std::forward<V>(v));
+
+            added_to(participant, shard, lock);
+        }
+
+        // Assigns v to k if k is present, adds them otherwise. Returns true if k was added.
+        template<typename V>
+        bool insert_or_assign(participant_t & participant, const key_t & k, V && v)
+        {
+            std::unique_lock<std::mutex> lock;
+            Shard & shard = lock_shard_of(participant, k, lock);
+            if (!shard.tree.insert_or_assign(k, std::forward<V>(v)))
+            {
+                return false;
+            }
+
+            added_to(participant, shard, lock);
+
+            return true;
+        }
+
+        // Copies the value of k to value. Returns false if k is not present.
+        bool find(participant_t & participant, const key_t & k, value_t & value)
+        {
+            std::unique_lock<std::mutex> lock;
+            const value_t* found = lock_shard_of(participant, k, lock).tree.find(k);
+            if (found == nullptr)
+            {
+                return false;
+            }
+
+            value = *found;
+
+            return true;
+        }
+
+        bool contains(participant_t & participant, const key_t & k)
+        {
+            std::unique_lock<std::mutex> lock;
+
+            return lock_shard_of(participant, k, lock).tree.contains(k);
+        }
+
+        // the value is copied, it is not protected by the lock of its shard any more when get returns
+        value_t get(participant_t & participant, const key_t & k)
+        {
+            std::unique_lock<std::mutex> lock;
+
+            return lock_shard_of(participant, k, lock).tree.get(k);
+        }
+
+        // Calls visit with the entries whose key is in [lo, hi) in key order. Each shard is locked while its
+        // part of the range is visited, so the visitor must not use the tree. A rebalance between two
+        // shards does not matter, the scan goes on from the lower boundary of the next shard.
+        template<typename VISITOR>
+        void scan(participant_t & participant, const key_t & lo, const key_t & hi, VISITOR visit)
+        {
+            key_t from = lo;
+            while (true)
+            {
+                std::unique_lock<std::mutex> lock;
+                const boundaries_t* current = nullptr;
+                size_t index = 0;
+                // a rebalance of two other shards may replace the boundaries while they are read
+                EpochManager::Guard guard = participant.pin();
+                Shard & shard = lock_shard_of(participant, from, lock, &current, &index);
+
+                bool is_last = index == current->size() || !((*current)[index] < hi);
+                shard.tree.scan(from, is_last ? hi : (*current)[index], [&visit] (typename tree_t::reference entry) {
+                    visit(const_reference(entry.key, entry.value));
+                });
+
+                if (is_last)
+                {
+                    return;
+                }
+
+                from = (*current)[index];
+            }
+        }
+
+        // all entries in key order, the shards are locked together so the result is consistent
+        std::vector<KV_pair> dump()
+        {
+            std::vector<std::unique_lock<std::mutex>> locks = lock_all();
+            std::vector<KV_pair> result;
+            for (std::unique_ptr<Shard> & shard : shard_list)
+            {
+                std::vector<KV_pair> entries = shard->tree.dump();
+                result.insert(result.end(), std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+            }
+
+            return result;
+        }
+
+        // the sum of the shard sizes, writers of other shards may change it meanwhile
+        size_t size() const noexcept
+        {
+            size_t result = 0;
+            for (const std::unique_ptr<Shard> & shard : shard_list)
+            {
+                result += shard->size.load(std::memory_order_relaxed);
+            }
+
+            return result;
+        }
+
+        std::array<size_t, SHARDS> shard_sizes()
+        {
+            std::array<size_t, SHARDS> sizes;
+            for (size_t i = 0; i < SHARDS; i++)
+            {
+                std::lock_guard<std::mutex> lock(shard_list[i]->mutex);
+                sizes[i] = shard_list[i]->size.load(std::memory_order_relaxed);
+            }
+
+            return sizes;
+        }
+
+        // the boundaries are replaced only by a rebalance, which holds the rebalance mutex
+        boundaries_t shard_boundaries()
+        {
+            std::lock_guard<std::mutex> rebalancing(rebalance_mutex);
+
+            return *boundaries.load(std::memory_order_acquire);
+        }
+
+        // Moves the boundaries so that every shard holds the same number of entries. All shards are locked
+        // meanwhile, their entries are moved out in order and bulk loaded into the shards again.
+        void rebalance(participant_t & participant)
+        {
+            std::lock_guard<std::mutex> rebalancing(rebalance_mutex);
+            rebalance_locked(participant);
+        }
+
+        // the participants are gone, the retired boundaries are reclaimed with the epoch manager
+        ~ShardedBtree()
+        {
+            delete boundaries.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // The range of a shard changes only while the shard is locked: if the boundaries are the same after
+        // the shard is locked, the shard still holds k. Otherwise the shard is unlocked and k is looked up again.
+        // The epoch is pinned while the boundaries are read without a lock.
+        Shard & lock_shard_of(participant_t & participant, const key_t & k, std::unique_lock<std::mutex> & lock,
+                              const boundaries_t** locked_boundaries = nullptr, size_t* locked_index = nullptr)
+        {
+            EpochManager::Guard guard = participant.pin();
+            while (true)
+            {
+                const boundaries_t* current = boundaries.load(std::memory_order_acquire);
+                size_t index = std::upper_bound(current->begin(), current->end(), k) - current->begin();
+                Shard & shard = *shard_list[index];
+                lock = std::unique_lock<std::mutex>(shard.mutex);
+                if (boundaries.load(std::memory_order_acquire) == current)
+                {
+                    if (locked_boundaries != nullptr)
+                    {
+                        *locked_boundaries = current;
+                        *locked_index = index;
+                    }
+
+                    return shard;
+                }
+
+                lock.unlock();
+            }
+        }
+
+        // Counts the new entry in its shard only, writers of different shards share no counter. Every
+        // hot_check_interval entries the shard sums up the size of the tree and rebalances when it became
+        // hot: it holds more than one and a half times its share, and the tree grew by half since the last
+        // rebalance, which keeps the moved entries per added entry constant.
+        void added_to(participant_t & participant, Shard & shard, std::unique_lock<std::mutex> & lock)
+        {
+            size_t shard_size = shard.size.load(std::memory_order_relaxed) + 1;
+            shard.size.store(shard_size, std::memory_order_relaxed);
+            lock.unlock();
+
+            if (SHARDS == 1 || shard_size < min_rebalanced_size || shard_size % hot_check_interval != 0)
+            {
+                return;
+            }
+
+            size_t total = size();
+            bool is_hot = 2 * SHARDS * shard_size > 3 * total;
+            bool has_grown = 2 * total > 3 * total_at_rebalance.load(std::memory_order_relaxed);
+            if (is_hot && has_grown)
+            {
+                std::unique_lock<std::mutex> rebalancing(rebalance_mutex, std::try_to_lock);
+                if (rebalancing.owns_lock())
+                {
+                    rebalance_hot(participant, shard, total);
+                }
+            }
+        }
+
+        // Moves the boundary between the hot shard and its smaller neighbour so that the two hold the same
+        // number of entries. Only these two shards are locked and only their entries move, writers of the
+        // other shards go on. All shards are rebalanced instead while some of them have no range yet, or
+        // when the two halves would still be hot.
+        void rebalance_hot(participant_t & participant, Shard & hot, const size_t total)
+        {
+            // only a rebalance replaces the boundaries and the rebalance mutex is held
+            const boundaries_t & current = *boundaries.load(std::memory_order_acquire);
+            size_t index = 0;
+            while (shard_list[index].get() != &hot)
+            {
+                index++;
+            }
+
+            size_t left = index;
+            if (index == SHARDS - 1 || (index > 0 && shard_list[index - 1]->size.load(std::memory_order_relaxed)
+                                                     < shard_list[index + 1]->size.load(std::memory_order_relaxed)))
+            {
+                left = index - 1;
+            }
+
+            std::unique_lock<std::mutex> left_lock(shard_list[left]->mutex);
+            std::unique_lock<std::mutex> right_lock(shard_list[left + 1]->mutex);
+            size_t pair_size = shard_list[left]->size.load(std::memory_order_relaxed)
+                + shard_list[left + 1]->size.load(std::memory_order_relaxed);
+            if (current.size() < SHARDS - 1 || SHARDS * pair_size > 3 * total)
+            {
+                right_lock.unlock();
+                left_lock.unlock();
+                rebalance_locked(participant);
+
+                return;
+            }
+
+            std::vector<KV> entries;
+            entries.reserve(pair_size);
+            drain(*shard_list[left], entries);
+            drain(*shard_list[left + 1], entries);
+
+            size_t middle = entries.size() / 2;
+            boundaries_t new_boundaries = current;
+            new_boundaries[left] = entries[middle].key;
+            load(*shard_list[left], entries.begin(), entries.begin() + middle);
+            load(*shard_list[left + 1], entries.begin() + middle, entries.end());
+
+            publish(participant, std::move(new_boundaries));
+            total_at_rebalance.store(total, std::memory_order_relaxed);
+        }
+
+        void rebalance_locked(participant_t & participant)
+        {
+            std::vector<std::unique_lock<std::mutex>> locks = lock_all();
+
+            std::vector<KV> entries;
+            entries.reserve(size());
+            for (std::unique_ptr<Shard> & shard : shard_list)
+            {
+                drain(*shard, entries);
+            }
+
+            size_t n = entries.size();
+            boundaries_t new_boundaries;
+            for (size_t i = 1; i < SHARDS && n >= SHARDS; i++)
+            {
+                new_boundaries.push_back(entries[i * n / SHARDS].key);
+            }
+
+            for (size_t i = 0; i <= new_boundaries.size(); i++)
+            {
+                size_t first = new_boundaries.empty() ? 0 : i * n / SHARDS;
+                size_t last = new_boundaries.empty() ? n : (i + 1) * n / SHARDS;
+                load(*shard_list[i], entries.begin() + first, entries.begin() + last);
+            }
+
+            publish(participant, std::move(new_boundaries));
+            total_at_rebalance.store(n, std::memory_order_relaxed);
+        }
+
+        // moves the entries of a locked shard out in order and leaves it empty
+        static void drain(Shard & shard, std::vector<KV> & entries)
+        {
+            shard.tree.inorder_walk([&entries] (typename tree_t::reference entry) {
+                entries.push_back(KV(entry.key, std::move(entry.value)));
+            });
+            shard.tree.clear();
+            shard.size.store(0, std::memory_order_relaxed);
+        }
+
+        // the locked shard is empty and [first, last) is sorted
+        static void load(Shard & shard, typename std::vector<KV>::iterator first, typename std::vector<KV>::iterator last)
+        {
+            shard.tree.bulk_load(std::make_move_iterator(first), std::make_move_iterator(last));
+            shard.size.store(last - first, std::memory_order_relaxed);
+        }
+
+        // in shard order, the order every thread which locks more than one shard takes them in
+        std::vector<std::unique_lock<std::mutex>> lock_all()
+        {
+            std::vector<std::unique_lock<std::mutex>> locks;
+            for (std::unique_ptr<Shard> & shard : shard_list)
+            {
+                locks.push_back(std::unique_lock<std::mutex>(shard->mutex));
+            }
+
+            return locks;
+        }
+
+        // readers which loaded the old boundaries before may still look at them
+        void publish(participant_t & participant, boundaries_t && new_boundaries)
+        {
+            boundaries_t* old = boundaries.exchange(new boundaries_t(std::move(new_boundaries)), std::memory_order_acq_rel);
+            participant.retire(old);
+        }
+    };
+
+    template <typename KEY, typename VALUE, size_t DEGREE, size_t SHARDS, typename LAYOUT, typename SEARCH, typename ALLOCATOR>
+    const size_t ShardedBtree<KEY, VALUE, DEGREE, SHARDS, LAYOUT, SEARCH, ALLOCATOR>::min_rebalanced_size;
+
+    template <typename KEY, typename VALUE, size_t DEGREE, size_t SHARDS, typename LAYOUT, typename SEARCH, typename ALLOCATOR>
+    const size_t ShardedBtree<KEY, VALUE, DEGREE, SHARDS, LAYOUT, SEARCH, ALLOCATOR>::hot_check_interval;
+}
+
+#endif
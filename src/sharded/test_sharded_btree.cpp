@@ -0,0 +1 @@
+#include "test_sharded_btree.hpp"
@@ -0,0 +1,190 @@
+#ifndef TEST_SHARDED_BTREE_H_
+#define TEST_SHARDED_BTREE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "sharded/sharded_btree.hpp"
+
+
+using namespace btree;
+
+TEST(ShardedBtree, keysGoToTheShardOfTheirRange) {
+    using tree_t = ShardedBtree<int, int, 4, 4>;
+    tree_t t({100, 200, 300});
+    tree_t::participant_t participant = t.participant();
+    std::vector<int> keys;
+    for (int i = 0; i < 400; i++)
+    {
+        keys.push_back(i);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(3));
+    for (int k : keys)
+    {
+        t.add(participant, k, -k);
+    }
+
+    std::array<size_t, 4> sizes = {{100, 100, 100, 100}};
+    ASSERT_EQ(sizes, t.shard_sizes());
+    ASSERT_EQ(400, t.size());
+    ASSERT_EQ(-250, t.get(participant, 250));
+
+    std::vector<int> scanned;
+    t.scan(participant, 50, 350, [&scanned] (tree_t::const_reference entry) {
+        scanned.push_back(entry.key);
+    });
+    ASSERT_EQ(300, scanned.size());
+    ASSERT_TRUE(std::is_sorted(scanned.begin(), scanned.end()));
+    ASSERT_EQ(50, scanned.front());
+    ASSERT_EQ(349, scanned.back());
+}
+
+TEST(ShardedBtree, duplicateKeyAndInsertOrAssign) {
+    ShardedBtree<std::string, int, 3, 2> t({"m"});
+    auto participant = t.participant();
+    t.add(participant, "a", 1);
+    t.add(participant, "z", 2);
+
+    ASSERT_THROW(t.add(participant, "z", 3), duplicated_key_exception);
+    ASSERT_FALSE(t.insert_or_assign(participant, "a", 4));
+    ASSERT_TRUE(t.insert_or_assign(participant, "n", 5));
+
+    int value = 0;
+    ASSERT_TRUE(t.find(participant, "a", value));
+    ASSERT_EQ(4, value);
+    ASSERT_FALSE(t.contains(participant, "b"));
+    ASSERT_THROW(t.get(participant, "b"), key_does_not_exist_exception);
+    ASSERT_EQ(3, t.size());
+}
+
+TEST(ShardedBtree, rebalanceGivesTheShardsTheSameSize) {
+    ShardedBtree<int, int, 8, 4> t({10, 20, 30});
+    auto participant = t.participant();
+    for (int i = 0; i < 1000; i++)
+    {
+        t.add(participant, 1000 + i, i);
+    }
+
+    t.rebalance(participant);
+    // the replaced boundaries wait until no reader can hold them any more
+    ASSERT_EQ(1, participant.pending());
+
+    std::array<size_t, 4> sizes = {{250, 250, 250, 250}};
+    ASSERT_EQ(sizes, t.shard_sizes());
+    std::vector<int> boundaries = {1250, 1500, 1750};
+    ASSERT_EQ(boundaries, t.shard_boundaries());
+    ASSERT_EQ(1000, t.dump().size());
+}
+
+TEST(ShardedBtree, hotShardIsRebalancedWhileAppending) {
+    ShardedBtree<int, int, 8, 4> t;
+    auto participant = t.participant();
+    for (int i = 0; i < 20000; i++)
+    {
+        t.add(participant, i, i);
+    }
+
+    ASSERT_EQ(3, t.shard_boundaries().size());
+    for (size_t size : t.shard_sizes())
+    {
+        ASSERT_GT(size, 0);
+    }
+
+    std::vector<std::pair<int, int>> entries = t.dump();
+    ASSERT_EQ(20000, entries.size());
+    for (int i = 0; i < 20000; i++)
+    {
+        ASSERT_EQ(std::make_pair(i, i), entries[i]);
+    }
+}
+
+TEST(ShardedBtree, hotShardMovesOnlyTheBoundaryToItsNeighbour) {
+    ShardedBtree<int, int, 8, 4> t({1000, 2000, 3000});
+    auto participant = t.participant();
+    int k = 0;
+    for (; k < 3000; k++)
+    {
+        t.add(participant, k, k);
+    }
+
+    std::vector<int> boundaries = {1000, 2000, 3000};
+    while (t.shard_boundaries() == boundaries)
+    {
+        t.add(participant, k, k);
+        k++;
+    }
+
+    std::vector<int> moved = t.shard_boundaries();
+    ASSERT_EQ(1000, moved[0]);
+    ASSERT_EQ(2000, moved[1]);
+    ASSERT_LT(3000, moved[2]);
+    std::array<size_t, 4> sizes = t.shard_sizes();
+    ASSERT_EQ(1000, sizes[0]);
+    ASSERT_EQ(1000, sizes[1]);
+    ASSERT_LE(sizes[3] - 1, sizes[2]);
+    ASSERT_LE(sizes[2], sizes[3]);
+    ASSERT_EQ(static_cast<size_t>(k), t.size());
+    ASSERT_EQ(k - 1, t.get(participant, k - 1));
+}
+
+TEST(ShardedBtree, concurrentWritersAndScans) {
+    using tree_t = ShardedBtree<int, int, 16, 8>;
+    const int writers = 8;
+    const int keys_per_writer = 3000;
+    tree_t t;
+    std::atomic<int> running{writers};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; w++)
+    {
+        threads.emplace_back([&t, &running, w] {
+            tree_t::participant_t participant = t.participant();
+            std::vector<int> keys;
+            for (int i = 0; i < keys_per_writer; i++)
+            {
+                keys.push_back(i * writers + w);
+            }
+            std::shuffle(keys.begin(), keys.end(), std::mt19937(w));
+            for (int k : keys)
+            {
+                t.add(participant, k, -k);
+            }
+            running--;
+        });
+    }
+
+    tree_t::participant_t participant = t.participant();
+    while (running.load() > 0)
+    {
+        int previous = -1;
+        t.scan(participant, 0, writers * keys_per_writer, [&previous, &errors] (tree_t::const_reference entry) {
+            if (entry.key <= previous || entry.value != -entry.key)
+            {
+                errors++;
+            }
+            previous = entry.key;
+        });
+    }
+    for (std::thread & thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(0, errors.load());
+    ASSERT_EQ(writers * keys_per_writer, t.size());
+    std::vector<std::pair<int, int>> entries = t.dump();
+    ASSERT_EQ(writers * keys_per_writer, entries.size());
+    for (int k = 0; k < writers * keys_per_writer; k++)
+    {
+        ASSERT_EQ(std::make_pair(k, -k), entries[k]);
+    }
+}
+
+#endif
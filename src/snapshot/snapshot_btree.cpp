@@ -0,0 +1 @@
+#include "snapshot_btree.hpp"
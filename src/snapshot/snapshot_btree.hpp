@@ -0,0 +1,394 @@
+#ifndef SNAPSHOT_BTREE_H_
+#define SNAPSHOT_BTREE_H_
+
+#include<algorithm>
+#include<atomic>
+#include<cstddef>
+#include<memory>
+#include<mutex>
+#include<new>
+#include<utility>
+#include<vector>
+
+#include "epoch/epoch.hpp"
+#include "keys/keys.hpp"
+#include "keys/path.hpp"
+#include "pool/pool.hpp"
+
+
+namespace btree
+{
+    // B-tree whose nodes do not change once they are in the tree. A writer copies the nodes from the root
+    // to the one it changes (path copying), changes the copies and publishes the new root with one atomic
+    // store. A snapshot is the root at the moment it was taken: readers need no latch and see one
+    // consistent version of the tree however long they read, and taking a snapshot copies nothing.
+    // The replaced nodes are retired to an EpochManager and reclaimed once no snapshot can reach them.
+    // Every reading thread registers a reader. Writers take turns on a mutex. The readers go away before
+    // the tree.
+    template <typename KEY, typename VALUE, size_t DEGREE,
+              typename LAYOUT = interleaved_layout, typename SEARCH = default_search,
+              typename ALLOCATOR = std::allocator<char>>
+    class SnapshotBtree
+    {
+        // a node splits when it holds DEGREE + 1 entries, it gives the middle one to the parent
+        static_assert(DEGREE >= 2, "a split has to leave an entry on both sides");
+
+    public:
+        static const size_t degree = DEGREE;
+
+        using key_t = KEY;
+        using value_t = VALUE;
+        using layout_t = LAYOUT;
+        using search_t = SEARCH;
+        using allocator_t = ALLOCATOR;
+        using const_reference = KeyValueRef<KEY, const VALUE>;
+        using reader_t = EpochManager::Participant;
+
+    private:
+        using KV = KeyValue<key_t, value_t>;
+        using KV_pair = std::pair<key_t, value_t>;
+        using pool_t = NodePool<ALLOCATOR>;
+
+        // room for one entry more than the degree, a full node takes the new entry and then splits
+        struct Node
+        {
+            const bool is_leaf;
+            size_t size = 0;
+            NodeStorage<KEY, VALUE, DEGREE + 1, LAYOUT> entries;
+            Node* children[DEGREE + 2];
+
+            Node(const bool is_leaf): is_leaf(is_leaf) {}
+        };
+
+        // the nodes from the root to the changed one and the entry or child taken in each of them
+        using Path = NodePath<Node>;
+
+        // what replaces a node of the path in its copied parent: its copy, or the two halves of the copy
+        struct Replacement
+        {
+            Node* left;
+            Node* right;
+            KV median;
+        };
+
+        pool_t* pool;
+        std::unique_ptr<EpochManager> epochs;
+        std::unique_ptr<reader_t> writer;
+        std::mutex writer_mutex;
+        std::atomic<Node*> root;
+
+    public:
+        // A consistent view of the tree, it keeps the epoch of its reader pinned while it exists.
+        // The pointers it hands out stay valid as long as the snapshot.
+        class Snapshot
+        {
+        public:
+            Snapshot(Snapshot &&) = default;
+
+            const value_t* find(const key_t & k) const noexcept
+            {
+                Node* n = root;
+                while (true)
+                {
+                    size_t pos = search_t::lower_bound(n->entries, n->size, k);
+                    if (pos < n->size && !(k < n->entries.key(pos)))
+                    {
+                        return &n->entries.value(pos);
+                    }
+
+                    if (n->is_leaf)
+                    {
+                        return nullptr;
+                    }
+
+                    n = n->children[pos];
+                }
+            }
+
+            bool contains(const key_t & k) const noexcept
+            {
+                return find(k) != nullptr;
+            }
+
+            const value_t & get(const key_t & k) const
+            {
+                const value_t* value = find(k);
+                if (value == nullptr)
+                {
+                    BTREE_THROW(key_does_not_exist_exception());
+                }
+
+                return *value;
+            }
+
+            // Calls visit with the entries whose key is in [lo, hi) in key order.
+            template<typename VISITOR>
+            void scan(const key_t & lo, const key_t & hi, VISITOR visit) const
+            {
+                scan_node(root, &lo, &hi, visit);
+            }
+
+            std::vector<KV_pair> dump() const
+            {
+                std::vector<KV_pair> result;
+                auto collect = [&result] (const_reference entry) {
+                    result.push_back(entry);
+                };
+                scan_node(root, nullptr, nullptr, collect);
+
+                return result;
+            }
+
+            // number of levels, a tree with only a root leaf has height 1
+            size_t height() const noexcept
+            {
+                size_t result = 1;
+                for (Node* n = root; !n->is_leaf; n = n->children[0])
+                {
+                    result++;
+                }
+
+                return result;
+            }
+
+        private:
+            friend class SnapshotBtree;
+
+            EpochManager::Guard guard;
+            Node* root;
+
+            Snapshot(EpochManager::Guard && guard, Node* root): guard(std::move(guard)), root(root) {}
+
+            // a null bound is open
+            template<typename VISITOR>
+            static void scan_node(Node* n, const key_t * lo, const key_t * hi, VISITOR & visit)
+            {
+                size_t first = lo == nullptr ? 0 : search_t::lower_bound(n->entries, n->size, *lo);
+                size_t last = hi == nullptr ? n->size : search_t::lower_bound(n->entries, n->size, *hi);
+                for (size_t i = first; i < last; i++)
+                {
+                    if (!n->is_leaf)
+                    {
+                        scan_node(n->children[i], i == first ? lo : nullptr, nullptr, visit);
+                    }
+                    visit(const_reference(n->entries.key(i), n->entries.value(i)));
+                }
+
+                if (!n->is_leaf)
+                {
+                    scan_node(n->children[last], first == last ? lo : nullptr, hi, visit);
+                }
+            }
+        };
+
+        explicit SnapshotBtree(const ALLOCATOR & allocator = ALLOCATOR())
+            : pool(create_pool(allocator)), epochs(new EpochManager()), writer(new reader_t(*epochs))
+        {
+            root.store(new_node(true), std::memory_order_release);
+        }
+
+        SnapshotBtree(const SnapshotBtree &) = delete;
+        SnapshotBtree & operator=(const SnapshotBtree &) = delete;
+
+        ALLOCATOR get_allocator() const
+        {
+            return pool->get_allocator();
+        }
+
+        // Registers the calling thread as a reader, it takes its snapshots through the returned reader.
+        // Throws too_many_participants_exception if EpochManager::max_participants are registered.
+        reader_t reader()
+        {
+            return reader_t(*epochs);
+        }
+
+        Snapshot snapshot(reader_t & reader) const
+        {
+            EpochManager::Guard guard = reader.pin();
+
+            return Snapshot(std::move(guard), root.load(std::memory_order_acquire));
+        }
+
+        // Throws duplicated_key_exception if k is present.
+        template<typename K, typename V>
+        void add(K && k, V && v)
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            Path path;
+            if (find_path_to_key(k, path))
+            {
+                BTREE_THROW(duplicated_key_exception());
+            }
+
+            add_along_path(path, KV(std::forward<K>(k), std::forward<V>(v)));
+        }
+
+        // Assigns v to k if k is present, adds them otherwise. Returns true if k was added.
+        // Either way the path to k is copied, the snapshots taken before keep the old value.
+        template<typename V>
+        bool insert_or_assign(const key_t & k, V && v)
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            Path path;
+            if (find_path_to_key(k, path))
+            {
+                typename Path::Step & step = path.steps[path.length - 1];
+                Node* copy = copy_node(step.node);
+                copy->entries.value(step.pos) = std::forward<V>(v);
+                publish(path, path.length - 1, Replacement{copy, nullptr, KV()});
+
+                return false;
+            }
+
+            add_along_path(path, KV(k, std::forward<V>(v)));
+
+            return true;
+        }
+
+        // number of replaced nodes which wait until no snapshot can reach them
+        size_t retired_nodes()
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+
+            return writer->pending();
+        }
+
+        // the readers are gone, so the retired nodes are reclaimed with the epoch manager
+        ~SnapshotBtree()
+        {
+            destroy(root.load(std::memory_order_relaxed));
+            writer.reset();
+            epochs.reset();
+            destroy_pool(pool);
+        }
+
+    private:
+        // Goes down to k, the last step is the node where k is or would be added.
+        bool find_path_to_key(const key_t & k, Path & path) const
+        {
+            Node* n = root.load(std::memory_order_relaxed);
+            while (true)
+            {
+                size_t pos = search_t::lower_bound(n->entries, n->size, k);
+                path.steps[path.length++] = typename Path::Step{n, pos};
+                if (pos < n->size && !(k < n->entries.key(pos)))
+                {
+                    return true;
+                }
+
+                if (n->is_leaf)
+                {
+                    return false;
+                }
+
+                n = n->children[pos];
+            }
+        }
+
+        void add_along_path(Path & path, KV && kv)
+        {
+            typename Path::Step & step = path.steps[path.length - 1];
+            Node* copy = copy_node(step.node);
+            copy->entries.insert(step.pos, copy->size, std::move(kv));
+            copy->size++;
+
+            publish(path, path.length - 1, split_if_full(copy));
+        }
+
+        // Copies the parents of the replaced node up to the root, publishes the new root and retires
+        // the nodes of the path which are replaced.
+        void publish(Path & path, size_t level, Replacement && replacement)
+        {
+            while (level-- > 0)
+            {
+                typename Path::Step & step = path.steps[level];
+                Node* copy = copy_node(step.node);
+                copy->children[step.pos] = replacement.left;
+                if (replacement.right != nullptr)
+                {
+                    std::copy_backward(copy->children + step.pos + 1, copy->children + copy->size + 1,
+                        copy->children + copy->size + 2);
+                    copy->children[step.pos + 1] = replacement.right;
+                    copy->entries.insert(step.pos, copy->size, std::move(replacement.median));
+                    copy->size++;
+                }
+
+                replacement = split_if_full(copy);
+            }
+
+            Node* new_root = replacement.left;
+            if (replacement.right != nullptr)
+            {
+                new_root = new_node(false);
+                new_root->entries.insert(0, 0, std::move(replacement.median));
+                new_root->children[0] = replacement.left;
+                new_root->children[1] = replacement.right;
+                new_root->size = 1;
+            }
+            root.store(new_root, std::memory_order_release);
+
+            for (size_t i = 0; i < path.length; i++)
+            {
+                writer->retire(path.steps[i].node, reclaim_node, this);
+            }
+        }
+
+        // the copy is not published yet, it can be split in place
+        Replacement split_if_full(Node* copy)
+        {
+            if (copy->size <= DEGREE)
+            {
+                return Replacement{copy, nullptr, KV()};
+            }
+
+            Node* right = new_node(copy->is_leaf);
+            size_t middle = copy->size / 2;
+            right->entries.move(copy->entries, middle + 1, copy->size, 0);
+            right->size = copy->size - middle - 1;
+            if (!copy->is_leaf)
+            {
+                std::copy(copy->children + middle + 1, copy->children + copy->size + 1, right->children);
+            }
+
+            KV median = copy->entries.take(middle);
+            copy->size = middle;
+
+            return Replacement{copy, right, std::move(median)};
+        }
+
+        Node* new_node(const bool is_leaf)
+        {
+            return new (pool->allocate(sizeof(Node))) Node(is_leaf);
+        }
+
+        Node* copy_node(const Node* n)
+        {
+            return new (pool->allocate(sizeof(Node))) Node(*n);
+        }
+
+        void destroy_node(Node* n) noexcept
+        {
+            n->~Node();
+            pool->release(n);
+        }
+
+        static void reclaim_node(void* node, void* tree)
+        {
+            static_cast<SnapshotBtree*>(tree)->destroy_node(static_cast<Node*>(node));
+        }
+
+        void destroy(Node* n) noexcept
+        {
+            if (!n->is_leaf)
+            {
+                for (size_t i = 0; i <= n->size; i++)
+                {
+                    destroy(n->children[i]);
+                }
+            }
+            destroy_node(n);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1 @@
+#include "test_snapshot_btree.hpp"
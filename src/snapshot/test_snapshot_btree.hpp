@@ -0,0 +1,139 @@
+#ifndef TEST_SNAPSHOT_BTREE_H_
+#define TEST_SNAPSHOT_BTREE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "snapshot/snapshot_btree.hpp"
+#include "measurable/measurable_test_utils.hpp"
+
+
+using namespace btree;
+
+TEST(SnapshotBtree, nodesAreSearchedWithTheSearchPolicy) {
+    // a single leaf
+    SnapshotBtree<int, int, 16, interleaved_layout, CountingSearch> t;
+    auto reader = t.reader();
+    for (int i = 0; i < 8; i++)
+    {
+        t.add(i * 2, i);
+    }
+
+    CountingSearch::searches = 0;
+    t.add(5, 5);
+    ASSERT_EQ(1, CountingSearch::searches);
+
+    auto snapshot = t.snapshot(reader);
+    ASSERT_EQ(3, snapshot.get(6));
+    ASSERT_FALSE(snapshot.contains(7));
+    std::vector<int> scanned;
+    snapshot.scan(4, 9, [&scanned] (KeyValueRef<int, const int> entry) {
+        scanned.push_back(entry.key);
+    });
+    ASSERT_EQ(std::vector<int>({4, 5, 6, 8}), scanned);
+    ASSERT_EQ(5, CountingSearch::searches);
+}
+
+TEST(SnapshotBtree, snapshotDoesNotSeeLaterWrites) {
+    SnapshotBtree<int, std::string, 3> t;
+    auto reader = t.reader();
+    for (int i = 0; i < 100; i++)
+    {
+        t.add(i, std::to_string(i));
+    }
+
+    auto before = t.snapshot(reader);
+    for (int i = 100; i < 200; i++)
+    {
+        t.add(i, std::to_string(i));
+    }
+    ASSERT_FALSE(t.insert_or_assign(50, "changed"));
+
+    auto after = t.snapshot(reader);
+    ASSERT_EQ(100, before.dump().size());
+    ASSERT_EQ("50", before.get(50));
+    ASSERT_FALSE(before.contains(150));
+    ASSERT_EQ(200, after.dump().size());
+    ASSERT_EQ("changed", after.get(50));
+    ASSERT_EQ("150", after.get(150));
+    ASSERT_GT(after.height(), before.height());
+}
+
+TEST(SnapshotBtree, replacedNodesWaitForTheSnapshotsWhichCanReachThem) {
+    SnapshotBtree<int, int, 4> t;
+    auto reader = t.reader();
+    size_t retired_while_pinned = 0;
+    {
+        auto snapshot = t.snapshot(reader);
+        for (int i = 0; i < 500; i++)
+        {
+            t.add(i, i);
+        }
+        retired_while_pinned = t.retired_nodes();
+        ASSERT_GE(retired_while_pinned, 500);
+        ASSERT_EQ(0, snapshot.dump().size());
+    }
+
+    for (int i = 500; i < 1000; i++)
+    {
+        t.add(i, i);
+    }
+    ASSERT_LT(t.retired_nodes(), 3 * EpochManager::collect_threshold);
+}
+
+// One writer adds the keys in increasing order. Every snapshot holds a prefix of the keys,
+// and later snapshots of a reader hold longer prefixes.
+TEST(SnapshotBtree, readersSeeConsistentSnapshotsWhileWriting) {
+    using tree_t = SnapshotBtree<int, int, 8>;
+    const int keys = 5000;
+    tree_t t;
+    std::atomic<bool> writing{true};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++)
+    {
+        readers.emplace_back([&t, &writing, &errors] {
+            tree_t::reader_t reader = t.reader();
+            size_t previous = 0;
+            while (writing.load())
+            {
+                std::vector<std::pair<int, int>> entries = t.snapshot(reader).dump();
+                for (size_t i = 0; i < entries.size(); i++)
+                {
+                    if (entries[i] != std::make_pair(static_cast<int>(i), -static_cast<int>(i)))
+                    {
+                        errors++;
+                    }
+                }
+                if (entries.size() < previous)
+                {
+                    errors++;
+                }
+                previous = entries.size();
+            }
+        });
+    }
+
+    for (int k = 0; k < keys; k++)
+    {
+        t.add(k, -k);
+    }
+    writing.store(false);
+    for (std::thread & reader : readers)
+    {
+        reader.join();
+    }
+
+    ASSERT_EQ(0, errors.load());
+    auto reader = t.reader();
+    ASSERT_EQ(keys, t.snapshot(reader).dump().size());
+}
+
+#endif